@@ -5,41 +5,121 @@
 #define ALIVE   (1)    // for Cells.data
 #define DEAD    (0)
 
+#define CELLS_PER_WORD  (32)
+#define NUM_PLANES      (8)
+
+// The grid is bit-packed, one bit per cell and 32 cells per word.
+// A row is 'words' words, a plane is 'size.row' rows.
+// 'data' holds NUM_PLANES planes used as a ring buffer: the present
+// generation, the six previous generations and the next generation.
+// 'data' is reserved once for the size given to cells_create() and
+// re-carved by cells_resize() for any smaller size.
+// A seed made by cells_create_seed() has the DATA plane only, it can be
+// patterned but not evolved.
+// CE_ChangeList copies the rows whose neighbourhood did not change from
+// GEN(1) to DATA, and evolves the others as CE_Word does.
+typedef void (*CellsEvolutionRow)(const Cells *cells, int row, uint32_t *next_row);
+
 typedef struct cells {
     CSize size;
-    uint16_t data_size;
-    uint8_t *data;
+    uint32_t capacity;      // words reserved for all planes
+    uint16_t words;         // words per row
+    uint32_t plane_size;    // words per plane
+    uint8_t num_planes;     // NUM_PLANES, or 1 for a seed
+    uint8_t top;            // index of the DATA plane in the ring
+    CellsEvolutionRow evolution_row;    // specialised for 'words'
+    bool is_stats_enabled;  // see cells_set_stats_enabled()
+    CStats stats;           // of the DATA plane
+    CEngine engine;
+    bool is_history_valid;  // GEN(1) is the generation before DATA
+    uint8_t max_period;     // cycles up to this period end a run
+    uint8_t period;         // of the cycle being confirmed, 0 if none
+    uint8_t period_matches; // generations matched in that cycle
+    uint8_t hash_index;     // of the next hash in 'hashes'
+    uint8_t hash_count;
+    uint32_t hashes[CELLS_MAX_PERIOD];   // of the DATA plane, the last generations
+    uint32_t *data;
 } Cells;
 
 #define DATA        (0)
 #define GEN(n)      (n)    // 1..6
-#define TEMP        (7)
+#define NEXT        (7)
 
 #define ROUNDUP32BIT(n)    (((n) + 3) & ~3)
 
-static void s_cells_set_pattern_clock(Cells *cells);
+static uint32_t s_random_state = 2463534242u;   // xorshift32, never 0
+static uint8_t s_soup_density = (DEFAULT_SOUP_DENSITY * 256) / 100;    // n/256
+
+static Cells *s_cells_create(CSize size, uint8_t num_planes);
+static void s_cells_set_pattern_clock(Cells *cells, time_t when);
+static void s_cells_set_pattern_soup(Cells *cells);
+static uint16_t s_cells_calc_words(CSize size);
 
-inline static uint8_t s_cell_get(const Cells *cells, int bit, int row, int column);
-inline static void s_cell_set(Cells *cells, int bit, int row, int column, uint8_t life);
-inline static int s_cells_num_alive(const Cells *cells, int bit, int row, int col);
-static void s_cells_draw_font(Cells *cells, int bit, int offset_row, int offset_col, const CFont *font);
+inline static uint32_t *s_cells_plane(const Cells *cells, int plane);
+inline static uint8_t s_cell_get(const Cells *cells, int plane, int row, int column);
+inline static void s_cell_set(Cells *cells, int plane, int row, int column, uint8_t life);
+static CellsEvolutionRow s_cells_get_evolution_row(uint16_t words);
+inline static bool s_cells_is_row_changed(const Cells *cells, int row);
+static void s_cells_draw_font(Cells *cells, int plane, int offset_row, int offset_col, const CFont *font);
 static void s_math_cut_figure2(int num, int figure[2]);
 static void s_cells_rotate(Cells *cells);
 static bool s_cells_is_evolution(const Cells *cells);
+static void s_cells_period_clear(Cells *cells);
+static bool s_cells_is_long_cycle(Cells *cells);
+static void s_cells_stats_clear(CStats *stats);
+static void s_cells_stats_add(CStats *stats, int row, int word, uint32_t prev, uint32_t next);
+static void s_cells_stats_merge(CStats *stats, const CStats *stripe);
+static void s_cells_stats_update(Cells *cells);
+static uint32_t s_random_next(void);
 static bool s_true_or_false(void);
 static int s_value_in_range(int min, int max);
 
+void cells_set_random_seed(uint32_t seed) {
+    s_random_state = (seed == 0) ? 2463534242u : seed;
+}
+
+void cells_set_soup_density(uint8_t percent) {
+    if (100 <= percent) {
+        s_soup_density = 255;
+    } else {
+        s_soup_density = (percent * 256) / 100;
+    }
+}
+
 Cells *cells_create(CSize size) {
-    Cells *cells = NULL;
-    
-    uint16_t data_size = sizeof(uint8_t) * (size.row * size.column);
-    cells = malloc(ROUNDUP32BIT(sizeof(Cells)) + data_size);
-    if (cells != NULL) {
-        cells->size = size;
-        cells->data_size = data_size;
-        cells->data = &(((uint8_t*)cells)[ROUNDUP32BIT(sizeof(Cells))]);
+    return s_cells_create(size, NUM_PLANES);
+}
+
+Cells *cells_create_seed(CSize size) {
+    return s_cells_create(size, 1);
+}
+
+bool cells_resize(Cells *cells, CSize size) {
+    uint16_t words = s_cells_calc_words(size);
+    uint32_t plane_size = (uint32_t)words * size.row;
+
+    if (cells->capacity < (plane_size * cells->num_planes)) {
+        return false;
     }
-    return cells;
+    cells->size = size;
+    cells->words = words;
+    cells->plane_size = plane_size;
+    cells->top = 0;
+    cells->evolution_row = s_cells_get_evolution_row(words);
+    cells->is_history_valid = false;
+    s_cells_period_clear(cells);
+    s_cells_stats_clear(&cells->stats);
+    memset(cells->data, 0x00, sizeof(uint32_t) * plane_size * cells->num_planes);
+    return true;
+}
+
+bool cells_copy_seed(Cells *cells, const Cells *seed) {
+    if (cells_resize(cells, seed->size) == false) {
+        return false;
+    }
+    memcpy(s_cells_plane(cells, DATA), s_cells_plane(seed, DATA), sizeof(uint32_t) * seed->plane_size);
+    s_cells_stats_update(cells);
+    return true;
 }
 
 void cells_destroy(Cells *cells) {
@@ -57,15 +137,86 @@ bool cells_is_alive(const Cells *cells, uint16_t row, uint16_t column) {
     return s_cell_get(cells, DATA, row, column) == ALIVE ? true : false;
 }
 
+// Copies the packed DATA bits of 'row', CELLS_ROW_WORDS(column) words.
+void cells_get_row(const Cells *cells, uint16_t row, uint32_t *bits) {
+    memcpy(bits, &s_cells_plane(cells, DATA)[row * cells->words], sizeof(uint32_t) * cells->words);
+}
+
+// Sets every row of the DATA plane from 'rows', each one as cells_get_row()
+// gives it, and starts over the history as cells_set_pattern() does.
+void cells_set_rows(Cells *cells, const uint32_t *rows) {
+    uint32_t *data = s_cells_plane(cells, DATA);
+    int last_bit = (cells->size.column - 1) % CELLS_PER_WORD;
+
+    memset(cells->data, 0x00, sizeof(uint32_t) * cells->plane_size * cells->num_planes);
+    memcpy(data, rows, sizeof(uint32_t) * cells->plane_size);
+    if (last_bit != (CELLS_PER_WORD - 1)) {
+        for (int row = 0; row < cells->size.row; row++) {
+            data[(row * cells->words) + cells->words - 1] &= (0x01u << (last_bit + 1)) - 1;
+        }
+    }
+    cells->is_history_valid = false;
+    s_cells_period_clear(cells);
+    s_cells_stats_update(cells);
+}
+
+// Same as cells_get_row() but the cells changed in the last generation.
+void cells_get_row_changes(const Cells *cells, uint16_t row, uint32_t *bits) {
+    const uint32_t *data = &s_cells_plane(cells, DATA)[row * cells->words];
+
+    if (cells->num_planes == 1) {
+        memcpy(bits, data, sizeof(uint32_t) * cells->words);
+        return;
+    }
+    const uint32_t *prev = &s_cells_plane(cells, GEN(1))[row * cells->words];
+    for (int word = 0; word < cells->words; word++) {
+        bits[word] = data[word] ^ prev[word];
+    }
+}
+
+// Finds the first run of live cells at or after '*begin' in a row from
+// cells_get_row(), as [*begin, *end). Returns false if there is none.
+bool cells_find_run(const uint32_t *bits, uint16_t columns, uint16_t *begin, uint16_t *end) {
+    int col = *begin;
+
+    // skip dead cells
+    while (col < columns) {
+        uint32_t word = bits[col / CELLS_PER_WORD] >> (col % CELLS_PER_WORD);
+        if (word != 0) {
+            col += __builtin_ctz(word);
+            break;
+        }
+        col = ((col / CELLS_PER_WORD) + 1) * CELLS_PER_WORD;
+    }
+    if (columns <= col) {
+        return false;
+    }
+    *begin = col;
+
+    // skip live cells, the bits past 'columns' are always dead
+    while (col < columns) {
+        uint32_t word = ~bits[col / CELLS_PER_WORD] >> (col % CELLS_PER_WORD);
+        if (word != 0) {
+            col += __builtin_ctz(word);
+            break;
+        }
+        col = ((col / CELLS_PER_WORD) + 1) * CELLS_PER_WORD;
+    }
+    *end = col < columns ? col : columns;
+    return true;
+}
+
 void cells_set_pattern(Cells *cells, CPattern pattern) {
-    memset(cells->data, 0x00, cells->data_size);
+    memset(cells->data, 0x00, sizeof(uint32_t) * cells->plane_size * cells->num_planes);
+    cells->is_history_valid = false;
+    s_cells_period_clear(cells);
 
     switch (pattern) {
     case CP_None:
         break;
     case CP_Clock:
         {
-            s_cells_set_pattern_clock(cells);
+            s_cells_set_pattern_clock(cells, time(NULL));
         }
         break;
     case CP_Glider: 
@@ -136,41 +287,133 @@ void cells_set_pattern(Cells *cells, CPattern pattern) {
             s_cells_draw_font(cells, DATA, cells->size.row / 2, cells->size.column / 2, &font_pattern_pentomino);
         }
         break;
+    case CP_Soup:
+        {
+            s_cells_set_pattern_soup(cells);
+        }
+        break;
     default:
         break;
     }
+    s_cells_stats_update(cells);
 }
 
 bool cells_evolution(Cells *cells) {
-    s_cells_rotate(cells);
-    
-    for (int row = 0; row < cells->size.row; row++) {
-        for (int col = 0; col < cells->size.column; col++) {
-            int num_alive = s_cells_num_alive(cells, TEMP, row, col);
-            if (s_cell_get(cells, TEMP, row, col) == DEAD) {
-                if (num_alive == 3) {
-                    s_cell_set(cells, DATA, row, col, ALIVE);
-                }    
-            } else {
-                if ((num_alive == 2) || (num_alive == 3)) {
-                    s_cell_set(cells, DATA, row, col, ALIVE);
-                }
+    CStats stats;
+
+    s_cells_stats_clear(&stats);
+    cells_evolution_stripe(cells, 0, cells->size.row, &stats);
+    return cells_evolution_commit(cells, &stats, 1);
+}
+
+// Evolves the rows [row_begin, row_end) into the NEXT plane, and adds
+// their stats to '*stats', which starts zeroed.
+// A stripe reads only the DATA plane, including the rows around it, and
+// writes only its own rows of the NEXT plane and '*stats'. So the stripes
+// of one generation may be evolved in any order, or at the same time with
+// a CStats each, and give the same result.
+void cells_evolution_stripe(const Cells *cells, uint16_t row_begin, uint16_t row_end, CStats *stats) {
+    const uint32_t *data = s_cells_plane(cells, DATA);
+    uint32_t *next = s_cells_plane(cells, NEXT);
+    bool is_skipping = (cells->engine == CE_ChangeList) && (cells->is_history_valid == true);
+    bool is_changed[3] = {true, true, true};    // the rows above, at and below 'row'
+
+    if (cells->size.row < row_end) {
+        row_end = cells->size.row;
+    }
+    if (is_skipping == true) {
+        is_changed[1] = s_cells_is_row_changed(cells, (row_begin == 0 ? cells->size.row : row_begin) - 1);
+        is_changed[2] = s_cells_is_row_changed(cells, row_begin);
+    }
+    for (int row = row_begin; row < row_end; row++) {
+        int index = row * cells->words;
+        if (is_skipping == true) {
+            is_changed[0] = is_changed[1];
+            is_changed[1] = is_changed[2];
+            is_changed[2] = s_cells_is_row_changed(cells, row == (cells->size.row - 1) ? 0 : row + 1);
+        }
+        if ((is_changed[0] == false) && (is_changed[1] == false) && (is_changed[2] == false)) {
+            // no changes around the row keep it as it is
+            memcpy(&next[index], &data[index], sizeof(uint32_t) * cells->words);
+        } else {
+            (*cells->evolution_row)(cells, row, &next[index]);
+        }
+        if (cells->is_stats_enabled == true) {
+            for (int word = 0; word < cells->words; word++) {
+                s_cells_stats_add(stats, row, word, data[index + word], next[index + word]);
             }
         }
     }
-    
-    return s_cells_is_evolution(cells);
 }
 
-static void s_cells_set_pattern_clock(Cells *cells) {
-    time_t tim = time(NULL);
-    struct tm *ltim = localtime(&tim);
+// Makes the NEXT plane the present generation once every row has been
+// evolved, with the stats of its 'num_stats' stripes.
+bool cells_evolution_commit(Cells *cells, const CStats *stats, uint16_t num_stats) {
+    s_cells_rotate(cells);
+    s_cells_stats_clear(&cells->stats);
+    for (int i = 0; i < num_stats; i++) {
+        s_cells_stats_merge(&cells->stats, &stats[i]);
+    }
+    cells->is_history_valid = true;
+
+    bool is_long_cycle = s_cells_is_long_cycle(cells);
+    return (s_cells_is_evolution(cells) == true) && (is_long_cycle == false);
+}
+
+// The stats cost about as much as the evolution itself, so they are
+// collected only once enabled. They are all 0 while disabled.
+void cells_set_stats_enabled(Cells *cells, bool is_enabled) {
+    cells->is_stats_enabled = is_enabled;
+    s_cells_stats_update(cells);
+}
+
+CStats cells_get_stats(const Cells *cells) {
+    return cells->stats;
+}
+
+// A seed has no GEN(1) plane to compare with, so it takes CE_Word only.
+bool cells_set_engine(Cells *cells, CEngine engine) {
+    if ((engine == CE_ChangeList) && (cells->num_planes != NUM_PLANES)) {
+        return false;
+    }
+    cells->engine = engine;
+    return true;
+}
+
+// 1 ends a run only on a still life, up to CELLS_MAX_PERIOD.
+void cells_set_max_period(Cells *cells, uint8_t max_period) {
+    if (max_period < 1) {
+        max_period = 1;
+    } else if (CELLS_MAX_PERIOD < max_period) {
+        max_period = CELLS_MAX_PERIOD;
+    }
+    cells->max_period = max_period;
+    s_cells_period_clear(cells);
+}
+
+CEngine cells_get_engine(const Cells *cells) {
+    return cells->engine;
+}
+
+// Same as cells_set_pattern(CP_Clock) but shows 'when', e.g. the next minute.
+void cells_set_clock(Cells *cells, time_t when) {
+    cells_set_pattern(cells, CP_None);
+    s_cells_set_pattern_clock(cells, when);
+    s_cells_stats_update(cells);
+}
+
+static void s_cells_set_pattern_clock(Cells *cells, time_t when) {
+    struct tm *ltim = localtime(&when);
 
     int hour[2], min[2];
     s_math_cut_figure2(ltim->tm_hour, hour);
     s_math_cut_figure2(ltim->tm_min, min);
 
-    CSize offset;
+    // signed, the hours start left of column 0 on the narrowest grid
+    struct {
+        int row;
+        int column;
+    } offset;
     offset.row = (cells->size.row / 2) - (font_number[0].size.row / 2);
 
     // HH
@@ -197,52 +440,218 @@ static void s_cells_set_pattern_clock(Cells *cells) {
     s_cell_set(cells, DATA, offset.row, offset.column, ALIVE);
 }
 
-inline static int s_cell_calc_data_index(const CSize *size, int row, int column) {
-    if (row < 0) {
-        row = size->row + row;
-    } else if (size->row <= row) {
-        row = row - size->row;
+static Cells *s_cells_create(CSize size, uint8_t num_planes) {
+    Cells *cells = NULL;
+    
+    uint32_t capacity = (uint32_t)s_cells_calc_words(size) * size.row * num_planes;
+    cells = malloc(ROUNDUP32BIT(sizeof(Cells)) + (sizeof(uint32_t) * capacity));
+    if (cells != NULL) {
+        cells->capacity = capacity;
+        cells->num_planes = num_planes;
+        cells->engine = CE_Word;
+        cells->max_period = CELLS_MAX_PERIOD;
+        cells->is_stats_enabled = false;
+        cells->data = (uint32_t*)&(((uint8_t*)cells)[ROUNDUP32BIT(sizeof(Cells))]);
+        (void)cells_resize(cells, size);
+    }
+    return cells;
+}
+
+static uint16_t s_cells_calc_words(CSize size) {
+    return (size.column + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+}
+
+// Each bit is alive with the probability of 'density'/256: the bits of
+// 'density' are applied from the lowest one, OR-ing in a random word for
+// a 1 and AND-ing for a 0, which halves the probability and adds a half.
+static uint32_t s_random_word(uint8_t density) {
+    uint32_t word = 0;
+
+    for (int bit = 0; bit < 8; bit++) {
+        if (((density >> bit) & 0x01) == 1) {
+            word |= s_random_next();
+        } else {
+            word &= s_random_next();
+        }
+    }
+    return word;
+}
+
+static void s_cells_set_pattern_soup(Cells *cells) {
+    uint32_t *data = s_cells_plane(cells, DATA);
+    int last_bit = (cells->size.column - 1) % CELLS_PER_WORD;
+
+    for (int row = 0; row < cells->size.row; row++) {
+        uint32_t *words = &data[row * cells->words];
+        for (int word = 0; word < cells->words; word++) {
+            words[word] = s_random_word(s_soup_density);
+        }
+        if (last_bit != (CELLS_PER_WORD - 1)) {
+            words[cells->words - 1] &= (0x01u << (last_bit + 1)) - 1;
+        }
+    }
+}
+
+inline static void s_cell_wrap(const CSize *size, int *row, int *column) {
+    if (*row < 0) {
+        *row = size->row + *row;
+    } else if (size->row <= *row) {
+        *row = *row - size->row;
     } else {
         // do nothing
     }
-    if (column < 0) {
-        column = size->column + column;
-    } else if (size->column <= column) {
-        column = column - size->column;
+    if (*column < 0) {
+        *column = size->column + *column;
+    } else if (size->column <= *column) {
+        *column = *column - size->column;
     } else {
         // do nothing
     }
-    return (row * size->column) + column;
 }
 
-inline static uint8_t s_cell_get(const Cells *cells, int bit, int row, int column) {
-    return (cells->data[s_cell_calc_data_index(&cells->size, row, column)] >> bit) & 0x01;
+inline static uint32_t *s_cells_plane(const Cells *cells, int plane) {
+    return &cells->data[((cells->top + plane) % NUM_PLANES) * cells->plane_size];
+}
+
+inline static uint8_t s_cell_get(const Cells *cells, int plane, int row, int column) {
+    s_cell_wrap(&cells->size, &row, &column);
+    uint32_t word = s_cells_plane(cells, plane)[(row * cells->words) + (column / CELLS_PER_WORD)];
+    return (word >> (column % CELLS_PER_WORD)) & 0x01;
 }
 
-inline static void s_cell_set(Cells *cells, int bit, int row, int column, uint8_t life) {
+inline static void s_cell_set(Cells *cells, int plane, int row, int column, uint8_t life) {
+    s_cell_wrap(&cells->size, &row, &column);
+    uint32_t *word = &s_cells_plane(cells, plane)[(row * cells->words) + (column / CELLS_PER_WORD)];
     if (life == ALIVE) {
-        cells->data[s_cell_calc_data_index(&cells->size, row, column)] |= (0x01 << bit);
+        *word |= (0x01u << (column % CELLS_PER_WORD));
     } else {
-        cells->data[s_cell_calc_data_index(&cells->size, row, column)] &= ~(0x01 << bit);
+        *word &= ~(0x01u << (column % CELLS_PER_WORD));
+    }
+}
+
+// The cells to the west (column - 1) of a word, wrapped around the row.
+inline static uint32_t s_word_west(const uint32_t *row, int word, int last_word, int last_bit) {
+    uint32_t carry = (word == 0) ? (row[last_word] >> last_bit) : (row[word - 1] >> (CELLS_PER_WORD - 1));
+    return (row[word] << 1) | (carry & 0x01);
+}
+
+// The cells to the east (column + 1) of a word, wrapped around the row.
+inline static uint32_t s_word_east(const uint32_t *row, int word, int last_word, int last_bit) {
+    if (word == last_word) {
+        return (row[word] >> 1) | ((row[0] & 0x01) << last_bit);
+    }
+    return (row[word] >> 1) | (row[word + 1] << (CELLS_PER_WORD - 1));
+}
+
+inline static bool s_row_is_empty(const uint32_t *row, int words) {
+    for (int word = 0; word < words; word++) {
+        if (row[word] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Evolves 32 cells at a time: the eight neighbour words are summed up by
+// a bit-sliced adder network, so each bit of a word is one cell's count.
+// It is always inlined so that a constant 'words' unrolls the word loop
+// and resolves the wraparound at the first and the last word.
+__attribute__((always_inline))
+inline static void s_cells_evolution_row_words(const Cells *cells, int row, uint32_t *next_row, const int words) {
+    const uint32_t *data = s_cells_plane(cells, DATA);
+    int last_word = words - 1;
+    int last_bit = (cells->size.column - 1) % CELLS_PER_WORD;
+    const uint32_t *up = &data[(row == 0 ? cells->size.row - 1 : row - 1) * words];
+    const uint32_t *mid = &data[row * words];
+    const uint32_t *down = &data[(row == cells->size.row - 1 ? 0 : row + 1) * words];
+
+    // dead rows around a row keep it dead
+    if (s_row_is_empty(up, words) && s_row_is_empty(mid, words) && s_row_is_empty(down, words)) {
+        memset(next_row, 0x00, sizeof(uint32_t) * words);
+        return;
+    }
+
+    for (int word = 0; word < words; word++) {
+        uint32_t uw = s_word_west(up, word, last_word, last_bit);
+        uint32_t u  = up[word];
+        uint32_t ue = s_word_east(up, word, last_word, last_bit);
+        uint32_t w  = s_word_west(mid, word, last_word, last_bit);
+        uint32_t c  = mid[word];
+        uint32_t e  = s_word_east(mid, word, last_word, last_bit);
+        uint32_t dw = s_word_west(down, word, last_word, last_bit);
+        uint32_t d  = down[word];
+        uint32_t de = s_word_east(down, word, last_word, last_bit);
+
+        // full adders for the upper and the lower three, a half adder for the middle two
+        uint32_t up_ones = uw ^ u ^ ue;
+        uint32_t up_twos = (uw & u) | (ue & (uw ^ u));
+        uint32_t down_ones = dw ^ d ^ de;
+        uint32_t down_twos = (dw & d) | (de & (dw ^ d));
+        uint32_t mid_ones = w ^ e;
+        uint32_t mid_twos = w & e;
+
+        // the ones of the three sums
+        uint32_t ones = up_ones ^ down_ones ^ mid_ones;
+        uint32_t ones_twos = (up_ones & down_ones) | (mid_ones & (up_ones ^ down_ones));
+
+        // exactly one of the four twos makes the count 2 or 3
+        uint32_t twos_a = up_twos ^ down_twos;
+        uint32_t twos_b = mid_twos ^ ones_twos;
+        uint32_t two_or_three = (twos_a ^ twos_b) & ~((up_twos & down_twos) | (mid_twos & ones_twos));
+
+        next_row[word] = two_or_three & (ones | c);
+    }
+
+    // clear the bits beyond the last column
+    if (last_bit != (CELLS_PER_WORD - 1)) {
+        next_row[last_word] &= (0x01u << (last_bit + 1)) - 1;
+    }
+}
+
+// One specialised kernel per row width in words. Every cell size on the
+// 144 and 180 pixel wide screens needs 1 to 3 words per row.
+#define DEFINE_EVOLUTION_ROW(n) \
+    static void s_cells_evolution_row_##n(const Cells *cells, int row, uint32_t *next_row) { \
+        s_cells_evolution_row_words(cells, row, next_row, n); \
     }
+DEFINE_EVOLUTION_ROW(1)
+DEFINE_EVOLUTION_ROW(2)
+DEFINE_EVOLUTION_ROW(3)
+
+static void s_cells_evolution_row_any(const Cells *cells, int row, uint32_t *next_row) {
+    s_cells_evolution_row_words(cells, row, next_row, cells->words);
 }
 
-inline static int s_cells_num_alive(const Cells *cells, int bit, int row, int col) {
-    int num = 0;
+inline static bool s_cells_is_row_changed(const Cells *cells, int row) {
+    int index = row * cells->words;
+    const uint32_t *data = &s_cells_plane(cells, DATA)[index];
+    const uint32_t *prev = &s_cells_plane(cells, GEN(1))[index];
 
-    for (int r = (row - 1); r <= (row + 1); r++) {
-        for (int c = (col - 1); c <= (col + 1); c++) {
-            num += s_cell_get(cells, bit, r, c);
+    for (int word = 0; word < cells->words; word++) {
+        if (data[word] != prev[word]) {
+            return true;
         }
     }
-    num -= s_cell_get(cells, bit, row, col);
-    return num;
+    return false;
+}
+
+static CellsEvolutionRow s_cells_get_evolution_row(uint16_t words) {
+    static const CellsEvolutionRow evolution_rows[] = {
+        s_cells_evolution_row_any,
+        s_cells_evolution_row_1,
+        s_cells_evolution_row_2,
+        s_cells_evolution_row_3
+    };
+    if (words < (sizeof(evolution_rows) / sizeof(evolution_rows[0]))) {
+        return evolution_rows[words];
+    }
+    return s_cells_evolution_row_any;
 }
 
-static void s_cells_draw_font(Cells *cells, int bit, int offset_row, int offset_col, const CFont *font) {
+static void s_cells_draw_font(Cells *cells, int plane, int offset_row, int offset_col, const CFont *font) {
     for (int r = 0; r < font->size.row; r++) {
         for (int c = 0; c < font->size.column; c++) {
-            s_cell_set(cells, bit, r+offset_row, c+offset_col, font->data[(r * font->size.column) + c]);
+            s_cell_set(cells, plane, r+offset_row, c+offset_col, font->data[(r * font->size.column) + c]);
         }
     }
 }
@@ -253,30 +662,18 @@ static void s_math_cut_figure2(int num, int figure[2]) {
 }
 
 static void s_cells_rotate(Cells *cells) {
-    int max = cells->size.row * cells->size.column;
-    
-    for (int i = 0; i < max; i++) {
-        cells->data[i] <<= 1;
-        if (((cells->data[i] >> GEN(1)) & 0x01) == ALIVE) {
-            cells->data[i] |= (0x01 << TEMP);
-        } else {
-            cells->data[i] &= ~(0x01 << TEMP);
-        }
-    }
+    // NEXT becomes DATA, DATA becomes GEN(1), ... and GEN(6) is reused as NEXT
+    cells->top = (cells->top + NEXT) % NUM_PLANES;
 }
 
 static bool s_cells_is_evolution(const Cells *cells) {
     bool evolution = false;
-    int max = cells->size.row * cells->size.column;
+    const uint32_t *data = s_cells_plane(cells, DATA);
 
-    for (int gen = 1; gen <= 6; gen++) {
+    for (int gen = 1; (gen <= 6) && (gen <= cells->max_period); gen++) {
         evolution = false;
-        for (int i = 0; i < max; i++) {
-            uint8_t d = cells->data[i];
-            if (((d >> DATA) & 0x01) != ((d >> GEN(gen)) & 0x01)) {
-                evolution = true;
-                break;
-            }
+        if (memcmp(data, s_cells_plane(cells, GEN(gen)), sizeof(uint32_t) * cells->plane_size) != 0) {
+            evolution = true;
         }
         if (evolution == false) {
             break;
@@ -285,10 +682,129 @@ static bool s_cells_is_evolution(const Cells *cells) {
     return evolution;
 }
 
+static void s_cells_period_clear(Cells *cells) {
+    cells->period = 0;
+    cells->period_matches = 0;
+    cells->hash_index = 0;
+    cells->hash_count = 0;
+}
+
+static uint32_t s_cells_hash_plane(const Cells *cells, int plane) {
+    const uint32_t *data = s_cells_plane(cells, plane);
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t index = 0; index < cells->plane_size; index++) {
+        hash = (hash ^ data[index]) * 16777619u;
+        hash ^= hash >> 15;
+    }
+    return hash;
+}
+
+// Cycles of up to 6 generations are found by s_cells_is_evolution(), longer
+// ones by the hashes of the DATA plane. A cycle is confirmed once every
+// generation of one whole period has matched.
+static bool s_cells_is_long_cycle(Cells *cells) {
+    if (cells->max_period <= 6) {
+        return false;
+    }
+
+    uint32_t hash = s_cells_hash_plane(cells, DATA);
+    bool ret = false;
+
+    if (cells->period != 0) {
+        if (hash == cells->hashes[(cells->hash_index + CELLS_MAX_PERIOD - cells->period) % CELLS_MAX_PERIOD]) {
+            cells->period_matches++;
+            ret = cells->period_matches >= cells->period ? true : false;
+        } else {
+            cells->period = 0;
+        }
+    }
+    if (cells->period == 0) {
+        for (int period = 7; (period <= cells->hash_count) && (period <= cells->max_period); period++) {
+            if (hash == cells->hashes[(cells->hash_index + CELLS_MAX_PERIOD - period) % CELLS_MAX_PERIOD]) {
+                cells->period = period;
+                cells->period_matches = 1;
+                break;
+            }
+        }
+    }
+    cells->hashes[cells->hash_index] = hash;
+    cells->hash_index = (cells->hash_index + 1) % CELLS_MAX_PERIOD;
+    if (cells->hash_count < CELLS_MAX_PERIOD) {
+        cells->hash_count++;
+    }
+    return ret;
+}
+
+inline static int s_math_popcount(uint32_t n) {
+    n = n - ((n >> 1) & 0x55555555);
+    n = (n & 0x33333333) + ((n >> 2) & 0x33333333);
+    n = (n + (n >> 4)) & 0x0F0F0F0F;
+    return (int)((n * 0x01010101) >> 24);
+}
+
+static void s_cells_stats_clear(CStats *stats) {
+    memset(stats, 0x00, sizeof(CStats));
+}
+
+static void s_cells_stats_add(CStats *stats, int row, int word, uint32_t prev, uint32_t next) {
+    if ((prev | next) == 0) {
+        return;
+    }
+    stats->births += s_math_popcount(next & ~prev);
+    stats->deaths += s_math_popcount(prev & ~next);
+    if (next != 0) {
+        uint16_t min_col = (word * CELLS_PER_WORD) + __builtin_ctz(next);
+        uint16_t max_col = (word * CELLS_PER_WORD) + (CELLS_PER_WORD - 1) - __builtin_clz(next);
+        CStats word_stats = {s_math_popcount(next), 0, 0, {row, min_col}, {row, max_col}};
+        s_cells_stats_merge(stats, &word_stats);
+    }
+}
+
+static void s_cells_stats_merge(CStats *stats, const CStats *stripe) {
+    stats->births += stripe->births;
+    stats->deaths += stripe->deaths;
+    if (stripe->population == 0) {
+        return;
+    }
+    if (stats->population == 0) {
+        stats->min = stripe->min;
+        stats->max = stripe->max;
+    } else {
+        stats->min.row = stripe->min.row < stats->min.row ? stripe->min.row : stats->min.row;
+        stats->min.column = stripe->min.column < stats->min.column ? stripe->min.column : stats->min.column;
+        stats->max.row = stats->max.row < stripe->max.row ? stripe->max.row : stats->max.row;
+        stats->max.column = stats->max.column < stripe->max.column ? stripe->max.column : stats->max.column;
+    }
+    stats->population += stripe->population;
+}
+
+static void s_cells_stats_update(Cells *cells) {
+    const uint32_t *data = s_cells_plane(cells, DATA);
+
+    s_cells_stats_clear(&cells->stats);
+    if (cells->is_stats_enabled == false) {
+        return;
+    }
+    for (int row = 0; row < cells->size.row; row++) {
+        for (int word = 0; word < cells->words; word++) {
+            uint32_t d = data[(row * cells->words) + word];
+            s_cells_stats_add(&cells->stats, row, word, d, d);
+        }
+    }
+}
+
+static uint32_t s_random_next(void) {
+    s_random_state ^= s_random_state << 13;
+    s_random_state ^= s_random_state >> 17;
+    s_random_state ^= s_random_state << 5;
+    return s_random_state;
+}
+
 static bool s_true_or_false(void) {
-    return (rand() % 2) == 0 ? true : false;
+    return (s_random_next() & 0x01) == 0 ? true : false;
 }
 
 static int s_value_in_range(int min, int max) {
-    return (int)((rand() % (max - min + 1)) + min);
+    return (int)((s_random_next() % (max - min + 1)) + min);
 }
@@ -12,16 +12,55 @@ typedef enum cells_pattern {
     CP_Clock,
     CP_Glider,
     CP_Saceship,    // Spaceship
-    CP_RRntomino    // R-pentomino
+    CP_RRntomino,   // R-pentomino
+    CP_Soup         // random soup
     // You have to modify 'MAX_CPATTERN' value.
 } CPattern;
-#define MAX_CPATTERN    ((int)CP_RRntomino + 1)
+#define MAX_CPATTERN    ((int)CP_Soup + 1)
+
+#define DEFAULT_SOUP_DENSITY    (37)    // percent
+
+typedef enum cells_engine {
+    CE_Word = 0,    // every row, 32 cells at a time
+    CE_ChangeList   // only the rows around the rows changed in the last generation
+    // You have to modify 'MAX_CENGINE' value.
+} CEngine;
+#define MAX_CENGINE     ((int)CE_ChangeList + 1)
+
+#define CELLS_MAX_PERIOD        (30)    // the longest cycle which can end a run
+#define CELLS_ROW_WORDS(column) (((column) + 31) / 32)    // column c is bit c%32 of word c/32
+
+typedef struct cells_stats {
+    uint16_t population;
+    uint16_t births;        // in the last generation
+    uint16_t deaths;        // in the last generation
+    CSize min;              // bounding box of live cells,
+    CSize max;              // valid while population is not 0
+} CStats;
 
 typedef struct cells Cells;
 
+void cells_set_random_seed(uint32_t seed);
+void cells_set_soup_density(uint8_t percent);
+
 Cells *cells_create(CSize size);
+Cells *cells_create_seed(CSize size);
 void cells_destroy(Cells *cells);
+bool cells_resize(Cells *cells, CSize size);
+bool cells_copy_seed(Cells *cells, const Cells *seed);
+bool cells_set_engine(Cells *cells, CEngine engine);
+void cells_set_max_period(Cells *cells, uint8_t max_period);
+CEngine cells_get_engine(const Cells *cells);
 CSize cells_get_size(const Cells *cells);
 bool cells_is_alive(const Cells *cells, uint16_t row, uint16_t column);
+void cells_get_row(const Cells *cells, uint16_t row, uint32_t *bits);
+void cells_set_rows(Cells *cells, const uint32_t *rows);
+void cells_get_row_changes(const Cells *cells, uint16_t row, uint32_t *bits);
+bool cells_find_run(const uint32_t *bits, uint16_t columns, uint16_t *begin, uint16_t *end);
 void cells_set_pattern(Cells *cells, CPattern pattern);
+void cells_set_clock(Cells *cells, time_t when);
 bool cells_evolution(Cells *cells);
+void cells_evolution_stripe(const Cells *cells, uint16_t row_begin, uint16_t row_end, CStats *stats);
+bool cells_evolution_commit(Cells *cells, const CStats *stats, uint16_t num_stats);
+void cells_set_stats_enabled(Cells *cells, bool is_enabled);
+CStats cells_get_stats(const Cells *cells);
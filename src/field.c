@@ -1,18 +1,51 @@
 #include <pebble.h>
 #include "field.h"
 #include "cells.h"
+#include "recorder.h"
+
+#define HEAP_RESERVE        (2048)  // bytes left for the menu, the action bar and so on
+#define PROBE_GENERATIONS   (4)
+#define PROFILE_FRAMES      (50)    // logged at once
 
 typedef struct field {
     Layer *layer;
     GRect window_frame;
     int cell_size;
+    int cell_size_min;      // the smallest cell size the heap allows
+    CSize max_size;         // of the grid at 'cell_size_min'
+    int fast_cell_size_min; // the smallest cell size evolved within the budget
+    CEngine probed_engine;  // the faster one, chosen by field_probe()
     Cells *cells;
     bool is_draw_grid;
+    Recorder *recorder;     // NULL while not recording
+    uint16_t next_row;      // where field_evolution_slice() goes on, 0 if between generations
+    CStats next_stats;      // of the rows evolved up to 'next_row'
+    struct {
+        bool is_enabled;
+        uint16_t frames;
+        uint32_t msec;
+        uint32_t calls;     // of graphics_*() drawing the grid and the cells
+        uint32_t pixels;    // filled by the cells
+    } profile;              // see field_set_profiling()
+    struct {
+        Cells *cells;       // DATA plane only, reserved on the first use
+        int cell_size;
+        bool is_draw_grid;
+    } seed;                 // made by field_prepare(), shown by field_commit()
 } Field;
 
 static void s_layer_update_callback(Layer *layer, GContext *ctx);
+static void s_choose_settings(const Field *field, FieldSettings *settings, int *cell_size, bool *is_draw_grid);
+static bool s_create_cells(Field *field);
+static uint32_t s_probe_evolution(Field *field);
+static uint32_t s_time_get_msec(void);
+static GRect s_calc_layer_frame(GRect window_frame, int cell_size);
 static bool s_setting_cell_size(Field *field, int cell_size);
 static void s_setting_is_draw_grid(Field *field, bool is_draw);
+static void s_setting_engine(Field *field, CEngine engine);
+static void s_record_keyframe(Field *field);
+static void s_evolution_cancel(Field *field);
+static bool s_prepare_seed(Field *field, FieldSettings *settings);
 
 Field *field_create(GRect window_frame) {
     Field *field = NULL;
@@ -23,9 +56,16 @@ Field *field_create(GRect window_frame) {
         field->layer = layer;
         field->window_frame = window_frame;
         field->cell_size = 0;
-        field->cells = NULL;
         field->is_draw_grid = DEFAULT_IS_DRAW_GRID;
-        if (s_setting_cell_size(field, DEFAULT_CELL_SIZE) == true) {
+        field->seed.cells = NULL;
+        field->seed.cell_size = 0;
+        field->probed_engine = CE_Word;
+        field->recorder = NULL;
+        field->next_row = 0;
+        memset(&field->next_stats, 0x00, sizeof(CStats));
+        field->profile.is_enabled = false;
+        // sized by the first field_reset()
+        if (s_create_cells(field) == true) {
             layer_set_update_proc(layer, s_layer_update_callback);
         } else {
             field_destroy(field);
@@ -35,10 +75,55 @@ Field *field_create(GRect window_frame) {
     return field; 
 }
 
+// Chooses the engine and the cell sizes which can be evolved within
+// 'budget_ms' per generation. It takes a few generations at each size,
+// and leaves the cells cleared.
+void field_probe(Field *field, uint16_t budget_ms, FieldProbe *probe) {
+    s_evolution_cancel(field);
+
+    // the engine: the faster one on the largest grid
+    s_setting_cell_size(field, field->cell_size_min);
+    uint32_t word_msec = s_probe_evolution(field);
+    if (cells_set_engine(field->cells, CE_ChangeList) == true) {
+        if (s_probe_evolution(field) >= word_msec) {
+            (void)cells_set_engine(field->cells, CE_Word);
+        }
+    }
+    field->probed_engine = cells_get_engine(field->cells);
+
+    // the cell size: the smallest one within the budget
+    field->fast_cell_size_min = CELL_SIZE_MAX;
+    for (int cell_size = field->cell_size_min; cell_size < CELL_SIZE_MAX; cell_size++) {
+        s_setting_cell_size(field, cell_size);
+        if (s_probe_evolution(field) <= ((uint32_t)budget_ms * PROBE_GENERATIONS)) {
+            field->fast_cell_size_min = cell_size;
+            break;
+        }
+    }
+    cells_set_pattern(field->cells, CP_None);
+
+    probe->budget_ms = budget_ms;
+    probe->engine = (uint8_t)field->probed_engine;
+    probe->fast_cell_size_min = (uint8_t)field->fast_cell_size_min;
+}
+
+// Uses the results of an earlier field_probe() instead of probing again.
+void field_set_probe(Field *field, const FieldProbe *probe) {
+    field->probed_engine = probe->engine < MAX_CENGINE ? (CEngine)probe->engine : CE_Word;
+    field->fast_cell_size_min = probe->fast_cell_size_min;
+    if (field->fast_cell_size_min < field->cell_size_min) {
+        field->fast_cell_size_min = field->cell_size_min;
+    } else if (CELL_SIZE_MAX < field->fast_cell_size_min) {
+        field->fast_cell_size_min = CELL_SIZE_MAX;
+    }
+}
+
 void field_destroy(Field *field) {
     if (field == NULL) {
         return;
     }
+    recorder_destroy(field->recorder);
+    cells_destroy(field->seed.cells);
     cells_destroy(field->cells);
     layer_destroy(field->layer);
 }
@@ -48,36 +133,83 @@ bool field_reset(Field *field, FieldSettings *settings) {
     int cell_size;
     bool is_draw_grid;
 
-    switch (settings->cell_size) {
-    case CELL_SIZE_RANDOM:
-        cell_size = (rand() % (CELL_SIZE_MAX - CELL_SIZE_MIN)) + CELL_SIZE_MIN;
+    s_evolution_cancel(field);
+    s_choose_settings(field, settings, &cell_size, &is_draw_grid);
+    ret = s_setting_cell_size(field, cell_size);
+    s_setting_is_draw_grid(field, is_draw_grid);
+    switch (settings->engine) {
+    case ENGINE_WORD:
+        s_setting_engine(field, CE_Word);
         break;
+    case ENGINE_CHANGE_LIST:
+        s_setting_engine(field, CE_ChangeList);
+        break;
+    case ENGINE_AUTO: // fall down
     default:
-        cell_size = (int)settings->cell_size;
+        s_setting_engine(field, field->probed_engine);
         break;
     }
+    cells_set_max_period(field->cells, settings->max_period == 0 ? CELLS_MAX_PERIOD : settings->max_period);
+    
+    return ret;
+}
 
-    if (cell_size <= 3) {
-        is_draw_grid = false;
-    } else {
-        switch (settings->is_draw_grid) {
-        case DRAW_GRID_TRUE:
-            is_draw_grid = true;
-            break;
-        case DRAW_GRID_FALSE:
-            is_draw_grid = false;
-            break;
-        case DRAW_GRID_RANDOM: // fall down
-        default:
-            is_draw_grid = rand() % 2 == 0 ? true : false;
-            break;
+bool field_prepare(Field *field, FieldSettings *settings, CPattern pattern) {
+    if (s_prepare_seed(field, settings) == false) {
+        return false;
+    }
+    cells_set_pattern(field->seed.cells, pattern);
+    return true;
+}
+
+// Same as field_prepare(CP_Clock) but shows 'when', e.g. the next minute.
+bool field_prepare_clock(Field *field, FieldSettings *settings, time_t when) {
+    if (s_prepare_seed(field, settings) == false) {
+        return false;
+    }
+    cells_set_clock(field->seed.cells, when);
+    return true;
+}
+
+bool field_commit(Field *field) {
+    if (field->seed.cell_size == 0) {
+        return false;
+    }
+    if (field->cell_size != field->seed.cell_size) {
+        field->cell_size = field->seed.cell_size;
+        layer_set_frame(field->layer, s_calc_layer_frame(field->window_frame, field->cell_size));
+    }
+    s_evolution_cancel(field);
+    (void)cells_copy_seed(field->cells, field->seed.cells);
+    s_setting_is_draw_grid(field, field->seed.is_draw_grid);
+    field->seed.cell_size = 0;
+    s_record_keyframe(field);
+    field_mark_dirty(field);
+    return true;
+}
+
+// Logs every generation from now on, see recorder.h.
+bool field_set_recording(Field *field, bool is_recording) {
+    if (is_recording == false) {
+        recorder_destroy(field->recorder);
+        field->recorder = NULL;
+    } else if (field->recorder == NULL) {
+        field->recorder = recorder_create();
+        if (field->recorder == NULL) {
+            return false;
         }
+        s_record_keyframe(field);
     }
-    
-    ret = s_setting_cell_size(field, cell_size);
-    s_setting_is_draw_grid(field, is_draw_grid);
-    
-    return ret;
+    return true;
+}
+
+// Logs the cost of drawing every PROFILE_FRAMES frames.
+void field_set_profiling(Field *field, bool is_enabled) {
+    field->profile.is_enabled = is_enabled;
+    field->profile.frames = 0;
+    field->profile.msec = 0;
+    field->profile.calls = 0;
+    field->profile.pixels = 0;
 }
 
 void field_mark_dirty(Field *field) {
@@ -89,17 +221,49 @@ Layer *field_get_layer(const Field *field) {
 }
 
 void field_set_pattern(Field *field, CPattern pattern) {
+    s_evolution_cancel(field);
     cells_set_pattern(field->cells, pattern);
+    s_record_keyframe(field);
     field_mark_dirty(field);
 }
 
 bool field_evolution(Field *field) {
     int ret;
-    ret = cells_evolution(field->cells);
+    ret = field_evolution_without_render(field);
     field_mark_dirty(field);
     return ret;
 }
 
+bool field_evolution_without_render(Field *field) {
+    s_evolution_cancel(field);
+    bool ret = cells_evolution(field->cells);
+    if (field->recorder != NULL) {
+        recorder_delta(field->recorder, field->cells);
+    }
+    return ret;
+}
+
+// Evolves the next 'rows' rows of the next generation, without render.
+// Returns true once the last row is done and the generation is committed,
+// then '*is_evolution' is what field_evolution() would have returned.
+bool field_evolution_slice(Field *field, uint16_t rows, bool *is_evolution) {
+    CSize size = cells_get_size(field->cells);
+    uint16_t row_end = (size.row - field->next_row) <= rows ? size.row : (field->next_row + rows);
+
+    cells_evolution_stripe(field->cells, field->next_row, row_end, &field->next_stats);
+    if (row_end < size.row) {
+        field->next_row = row_end;
+        return false;
+    }
+    field->next_row = 0;
+    *is_evolution = cells_evolution_commit(field->cells, &field->next_stats, 1);
+    memset(&field->next_stats, 0x00, sizeof(CStats));
+    if (field->recorder != NULL) {
+        recorder_delta(field->recorder, field->cells);
+    }
+    return true;
+}
+
 static void s_draw_grid(GContext *ctx, Field *field) {
     CSize size = cells_get_size(field->cells);
 
@@ -110,29 +274,58 @@ static void s_draw_grid(GContext *ctx, Field *field) {
         for (int col = 0; col <= size.column; col++) {
             graphics_draw_line(ctx, (GPoint){col * field->cell_size, 0}, (GPoint){col * field->cell_size, size.row * field->cell_size});
         }   
+        if (field->profile.is_enabled == true) {
+            field->profile.calls += size.row + size.column + 2;
+        }
     }
 }
 
+// A run of live cells in a row is drawn as one rect.
 static void s_draw_cells(GContext *ctx, Field *field) {
     CSize size = cells_get_size(field->cells);
+    uint32_t bits[CELLS_ROW_WORDS(size.column)];
+    uint16_t begin;
+    uint16_t end;
 
     GRect rect;
-    rect.size.w = field->cell_size;
     rect.size.h = field->cell_size;
 
     for (int row = 0; row < size.row; row++) {
-        for (int col = 0; col < size.column; col++) {
-            if (cells_is_alive(field->cells, row, col) == true) {
-                rect.origin.x = col * field->cell_size;
-                rect.origin.y = row * field->cell_size;
-                graphics_fill_rect(ctx, rect, 0, GCornerNone);                
+        cells_get_row(field->cells, row, bits);
+        rect.origin.y = row * field->cell_size;
+        for (begin = 0; cells_find_run(bits, size.column, &begin, &end) == true; begin = end) {
+            rect.origin.x = begin * field->cell_size;
+            rect.size.w = (end - begin) * field->cell_size;
+            graphics_fill_rect(ctx, rect, 0, GCornerNone);
+            if (field->profile.is_enabled == true) {
+                field->profile.calls++;
+                field->profile.pixels += rect.size.w * rect.size.h;
             }
         }
     }
 }
 
+static uint32_t s_time_get_msec(void) {
+    time_t sec;
+    uint16_t msec;
+
+    time_ms(&sec, &msec);
+    return ((uint32_t)sec * 1000) + msec;
+}
+
+static void s_profile_frame(Field *field, uint32_t msec) {
+    field->profile.frames++;
+    field->profile.msec += msec;
+    if (field->profile.frames == PROFILE_FRAMES) {
+        APP_LOG(APP_LOG_LEVEL_DEBUG, "render: cell %d, %d msec, %d calls, %d pixels in %d frames",
+                field->cell_size, (int)field->profile.msec, (int)field->profile.calls, (int)field->profile.pixels, PROFILE_FRAMES);
+        field_set_profiling(field, true);
+    }
+}
+
 static void s_layer_update_callback(Layer *layer, GContext *ctx) {
     Field *field = (Field*)layer_get_data(layer);
+    uint32_t started = field->profile.is_enabled == true ? s_time_get_msec() : 0;
 
     graphics_context_set_stroke_color(ctx, GColorWhite);
     graphics_context_set_fill_color(ctx, GColorWhite);
@@ -142,6 +335,85 @@ static void s_layer_update_callback(Layer *layer, GContext *ctx) {
 
     // draw cells
     s_draw_cells(ctx, field);
+
+    if (field->profile.is_enabled == true) {
+        s_profile_frame(field, s_time_get_msec() - started);
+    }
+}
+
+static void s_choose_settings(const Field *field, FieldSettings *settings, int *cell_size, bool *is_draw_grid) {
+    switch (settings->cell_size) {
+    case CELL_SIZE_RANDOM:
+        // only from the sizes known to be evolved in time
+        if (field->fast_cell_size_min < CELL_SIZE_MAX) {
+            *cell_size = (rand() % (CELL_SIZE_MAX - field->fast_cell_size_min)) + field->fast_cell_size_min;
+        } else {
+            *cell_size = CELL_SIZE_MAX;
+        }
+        break;
+    default:
+        *cell_size = (int)settings->cell_size;
+        if (*cell_size < field->cell_size_min) {
+            *cell_size = field->cell_size_min;
+        }
+        break;
+    }
+
+    if (*cell_size <= 3) {
+        *is_draw_grid = false;
+    } else {
+        switch (settings->is_draw_grid) {
+        case DRAW_GRID_TRUE:
+            *is_draw_grid = true;
+            break;
+        case DRAW_GRID_FALSE:
+            *is_draw_grid = false;
+            break;
+        case DRAW_GRID_RANDOM: // fall down
+        default:
+            *is_draw_grid = rand() % 2 == 0 ? true : false;
+            break;
+        }
+    }
+}
+
+// Reserves the cells for the largest grid the heap allows, starting from
+// the smallest cell size. Room is left for the seed, reserved later.
+static bool s_create_cells(Field *field) {
+    for (int cell_size = CELL_SIZE_MIN; cell_size <= CELL_SIZE_MAX; cell_size++) {
+        GRect frame = s_calc_layer_frame(field->window_frame, cell_size);
+        CSize max_size = (CSize){frame.size.h / cell_size, frame.size.w / cell_size};
+        size_t seed_size = sizeof(uint32_t) * CELLS_ROW_WORDS(max_size.column) * max_size.row;
+        field->cells = cells_create(max_size);
+        if ((field->cells != NULL) && (heap_bytes_free() >= (HEAP_RESERVE + seed_size))) {
+            field->cell_size_min = cell_size;
+            field->fast_cell_size_min = cell_size;
+            field->max_size = max_size;
+            return true;
+        }
+        cells_destroy(field->cells);
+        field->cells = NULL;
+    }
+    return false;
+}
+
+// Returns msec taken by PROBE_GENERATIONS generations of a soup.
+static uint32_t s_probe_evolution(Field *field) {
+    cells_set_pattern(field->cells, CP_Soup);
+    uint32_t started = s_time_get_msec();
+    for (int i = 0; i < PROBE_GENERATIONS; i++) {
+        (void)cells_evolution(field->cells);
+    }
+    return s_time_get_msec() - started;
+}
+
+static GRect s_calc_layer_frame(GRect window_frame, int cell_size) {
+    GRect frame;
+    frame.origin.x = cell_size - 1;
+    frame.origin.y = cell_size - 1;
+    frame.size.w = window_frame.size.w - ((cell_size * 2) - 1) + (cell_size & 0x1);
+    frame.size.h = window_frame.size.h - ((cell_size * 2) - 1) + (cell_size & 0x1);
+    return frame;
 }
 
 static bool s_setting_cell_size(Field *field, int cell_size) {
@@ -155,22 +427,13 @@ static bool s_setting_cell_size(Field *field, int cell_size) {
         return true;
     }
 
-    // destroy
-    cells_destroy(field->cells);
-    field->cells = NULL;
-    
     // init layer frame
-    GRect frame;
-    frame.origin.x = cell_size - 1;
-    frame.origin.y = cell_size - 1;
-    frame.size.w = field->window_frame.size.w - ((cell_size * 2) - 1) + (cell_size & 0x1);
-    frame.size.h = field->window_frame.size.h - ((cell_size * 2) - 1) + (cell_size & 0x1);
+    GRect frame = s_calc_layer_frame(field->window_frame, cell_size);
     layer_set_frame(field->layer, frame);
 
-    // init field
-    field->cell_size = cell_size;
-    field->cells = cells_create((CSize){frame.size.h / cell_size, frame.size.w / cell_size});
-    if (field->cells != NULL) {
+    // init field (the cells are only re-carved, never reallocated)
+    if (cells_resize(field->cells, (CSize){frame.size.h / cell_size, frame.size.w / cell_size}) == true) {
+        field->cell_size = cell_size;
         ret = true;
     }
     return ret;
@@ -179,3 +442,43 @@ static bool s_setting_cell_size(Field *field, int cell_size) {
 static void s_setting_is_draw_grid(Field *field, bool is_draw) {
     field->is_draw_grid = is_draw;
 }
+
+static void s_record_keyframe(Field *field) {
+    if (field->recorder != NULL) {
+        recorder_keyframe(field->recorder, field->cells);
+    }
+}
+
+// Chooses the settings of the seed and sizes it.
+static bool s_prepare_seed(Field *field, FieldSettings *settings) {
+    if (field->seed.cells == NULL) {
+        field->seed.cells = cells_create_seed(field->max_size);
+        if (field->seed.cells == NULL) {
+            return false;
+        }
+    }
+    s_choose_settings(field, settings, &field->seed.cell_size, &field->seed.is_draw_grid);
+
+    GRect frame = s_calc_layer_frame(field->window_frame, field->seed.cell_size);
+    if (cells_resize(field->seed.cells, (CSize){frame.size.h / field->seed.cell_size, frame.size.w / field->seed.cell_size}) == false) {
+        field->seed.cell_size = 0;
+        return false;
+    }
+    return true;
+}
+
+// Drops a generation left half done by field_evolution_slice().
+static void s_evolution_cancel(Field *field) {
+    if (field->next_row != 0) {
+        memset(&field->next_stats, 0x00, sizeof(CStats));
+        field->next_row = 0;
+    }
+}
+
+static void s_setting_engine(Field *field, CEngine engine) {
+    if (cells_get_engine(field->cells) != engine) {
+        if (cells_set_engine(field->cells, engine) == false) {
+            (void)cells_set_engine(field->cells, CE_Word);
+        }
+    }
+}
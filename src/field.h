@@ -22,17 +22,39 @@ typedef struct field_settings {
         DRAW_GRID_TRUE,
         DRAW_GRID_FALSE
     } is_draw_grid;
+    enum {
+        ENGINE_AUTO = 0,    // as chosen by field_probe()
+        ENGINE_WORD,
+        ENGINE_CHANGE_LIST
+    } engine;
+    uint8_t max_period;     // 0 as CELLS_MAX_PERIOD
 } FieldSettings;
 
 #define DEFAULT_CELL_SIZE    (CELL_SIZE_6)
 #define DEFAULT_IS_DRAW_GRID (DRAW_GRID_TRUE)
 
+// What field_probe() found, kept between launches.
+typedef struct field_probe {
+    uint16_t budget_ms;             // per generation, as given to field_probe()
+    uint8_t engine;                 // CEngine
+    uint8_t fast_cell_size_min;
+} FieldProbe;
+
 typedef struct field Field;
 
 Field *field_create(GRect window_frame);
 void field_destroy(Field *field);
+void field_probe(Field *field, uint16_t budget_ms, FieldProbe *probe);
+void field_set_probe(Field *field, const FieldProbe *probe);
 bool field_reset(Field *field, FieldSettings *settings);
+bool field_prepare(Field *field, FieldSettings *settings, CPattern pattern);
+bool field_prepare_clock(Field *field, FieldSettings *settings, time_t when);
+bool field_commit(Field *field);
+bool field_set_recording(Field *field, bool is_recording);
+void field_set_profiling(Field *field, bool is_enabled);
 void field_mark_dirty(Field *field);
 Layer *field_get_layer(const Field *field);
 void field_set_pattern(Field *field, CPattern pattern);
 bool field_evolution(Field *field);
+bool field_evolution_without_render(Field *field);
+bool field_evolution_slice(Field *field, uint16_t rows, bool *is_evolution);
@@ -1,15 +1,41 @@
 #include "pebble.h"
 #include "field.h"
 #include "menu.h"
+#include "settings.h"
+#include "recorder.h"
 
 static Window *window;
 static Field *field;
+static Menu *menu;
+static SettingsWindow *settings_window;
+static Settings settings;
 static FieldSettings field_settings;
+static FieldSettings menu_settings;     // as last chosen from the menu
 static CPattern pattern;
 static uint16_t generation;
 static bool is_evolution;
 static AppTimer *timer;
 static ButtonId last_clicked;
+static bool is_clock_prepared;  // the next minute is ready in the seed
+static bool is_probe_pending;   // no probe for the present frame rate yet
+static bool is_restart_pending; // the run has ended and the next one is on the way
+
+typedef struct {
+    uint32_t deadline;      // msec, when the next frame has to be shown
+    uint16_t period;        // msec
+    uint8_t skipped;        // frames skipped in a row
+    uint16_t slice_rows;    // rows evolved at once, adapted to SLICE_BUDGET
+    uint8_t generations;    // evolved in this frame
+    uint16_t generation_msec;       // spent on the generation being evolved
+    uint16_t last_generation_msec;  // spent on the last one
+} Scheduler;
+static Scheduler scheduler;
+
+typedef struct {
+    bool is_paused;         // the timer was running when the focus was lost
+    uint32_t paused_time;   // msec
+} Focus;
+static Focus focus;
 
 #define TIMER_TICK_TIMER    ((AppTimer*)&timer)
 
@@ -34,34 +60,174 @@ static ActionBar action_bar;
 #define DELAY_AUTO_EVO_START_BY_MENU    (1000)
 #define DELAY_AUTO_EVO_START_BY_UP      (0)
 #define DELAY_AUTO_EVO_CLOCK            (1000)
-#define DELAY_AUTO_EVO_OTHER            (200)
+#define PREPARE_CLOCK_SEC               (55)     // the next minute is made from this second
+#define MAX_SKIPPED_FRAMES              (4)
+#define SLICE_BUDGET                    (8)     // msec, the longest time buttons wait for evolution
+#define DEFAULT_SLICE_ROWS              (16)
+#define MAX_GENERATIONS_PER_FRAME       (16)    // for the automatic speed
+#define MAX_CATCHUP_GENERATIONS         (25)    // evolved at once when the focus is back
 #define DELAY_AUTO_EVO_STOP             (1000)
 #define DELAY_MENU                      (500)
 #define DELAY_ACTIONBAR_HIDE            (3000)
 #define DELAY_ACTIONBAR_RECREATE        (1 * 60) // sec (not msec)
+#define PROFILE_RENDER                  (false)  // log the cost of drawing
 
+static void s_timer_start(void);
 static void s_timer_stop(void);
 static void s_field_init(CPattern _pattern);
-static void s_menu_select_callback(CPattern _pattern, FieldSettings settings);
+static void s_probe_if_pending(void);
+static void s_menu_select_callback(CPattern _pattern, FieldSettings _settings);
+static void s_settings_callback(void);
 static void s_config_provider(void *context);
 
+static uint32_t s_time_get_msec(void) {
+    time_t sec;
+    uint16_t msec;
+
+    time_ms(&sec, &msec);
+    return ((uint32_t)sec * 1000) + msec;
+}
+
+static void s_scheduler_start(uint32_t delay) {
+    scheduler.deadline = s_time_get_msec() + delay;
+    scheduler.period = 1000 / settings.frame_rate;
+    scheduler.skipped = 0;
+    scheduler.generations = 0;
+}
+
+// Advances the deadline by one frame and returns the delay until it.
+// A negative delay means the step overran its frame.
+static int32_t s_scheduler_next(void) {
+    scheduler.deadline += scheduler.period;
+    return (int32_t)(scheduler.deadline - s_time_get_msec());
+}
+
+static void s_restart_commit_callback(void *data) {
+    timer = NULL;
+    if (is_probe_pending == true) {
+        // the run has ended, so the probe cuts nothing short
+        s_probe_if_pending();
+        (void)field_prepare(field, &field_settings, pattern);
+    }
+    if (field_commit(field) == false) {
+        // no seed, make the next run in place
+        (void)field_reset(field, &field_settings);
+        field_set_pattern(field, pattern);
+    }
+    generation = 0;
+    is_evolution = true;
+    is_restart_pending = false;
+    s_timer_start();
+    action_bar.created_time = 0;
+}
+
+static void s_restart_prepare_callback(void *data) {
+    uint32_t started = s_time_get_msec();
+    (void)field_prepare(field, &field_settings, pattern);
+
+    int32_t delay = DELAY_AUTO_EVO_STOP - (int32_t)(s_time_get_msec() - started);
+    timer = app_timer_register(delay < 0 ? 0 : delay, s_restart_commit_callback, NULL);
+}
+
+// Doubles or halves the rows of a slice to keep it within SLICE_BUDGET.
+static void s_scheduler_adapt_slice(uint32_t elapsed) {
+    if (SLICE_BUDGET < elapsed) {
+        if (scheduler.slice_rows > 1) {
+            scheduler.slice_rows /= 2;
+        }
+    } else if (elapsed < (SLICE_BUDGET / 2)) {
+        if (scheduler.slice_rows < (UINT16_MAX / 2)) {
+            scheduler.slice_rows *= 2;
+        }
+    }
+}
+
+// Generations shown as one frame. The automatic speed fits as many as
+// it can into half of a frame, by the cost of the last generation.
+static uint8_t s_scheduler_generations_per_frame(void) {
+    if (settings.generations_per_frame != 0) {
+        return settings.generations_per_frame;
+    }
+    uint16_t generations = (scheduler.period / 2) / (scheduler.last_generation_msec + 1);
+    if (generations < 1) {
+        return 1;
+    }
+    return generations < MAX_GENERATIONS_PER_FRAME ? generations : MAX_GENERATIONS_PER_FRAME;
+}
+
+// A generation is evolved in slices of rows, each one a timer callback, so
+// that clicks are handled in between. Only the last generation of a frame
+// is shown.
 static void s_timer_callback(void *data) {
-    is_evolution = field_evolution(field);
+    uint32_t started = s_time_get_msec();
+    bool is_done = field_evolution_slice(field, scheduler.slice_rows, &is_evolution);
+    uint32_t elapsed = s_time_get_msec() - started;
+    s_scheduler_adapt_slice(elapsed);
+    scheduler.generation_msec += elapsed;
+    if (is_done == false) {
+        timer = app_timer_register(0, s_timer_callback, NULL);
+        return;
+    }
+    generation++;
+    scheduler.last_generation_msec = scheduler.generation_msec;
+    scheduler.generation_msec = 0;
+    scheduler.generations++;
+    if ((is_evolution == true) && (scheduler.generations < s_scheduler_generations_per_frame())) {
+        timer = app_timer_register(0, s_timer_callback, NULL);
+        return;
+    }
+    scheduler.generations = 0;
+
     if (is_evolution == true) {
-        timer = app_timer_register(DELAY_AUTO_EVO_OTHER, s_timer_callback, NULL);
+        int32_t delay = s_scheduler_next();
+        if ((delay < 0) && (scheduler.skipped < MAX_SKIPPED_FRAMES)) {
+            // late: keep the simulation going without showing this frame
+            scheduler.skipped++;
+            delay = 0;
+        } else {
+            if (delay < 0) {
+                // too late to catch up, so start over from now
+                s_scheduler_start(0);
+                delay = 0;
+            }
+            scheduler.skipped = 0;
+            field_mark_dirty(field);
+        }
+        timer = app_timer_register(delay, s_timer_callback, NULL);
+    } else if (settings.run_end == RUN_END_STOP) {
+        // show the final frame and wait for a button
+        field_mark_dirty(field);
+        timer = NULL;
     } else {
-        s_timer_stop();
-        psleep(DELAY_AUTO_EVO_STOP);
-        s_menu_select_callback(pattern, field_settings);
+        // show the final frame, then prepare the next run while it is shown
+        field_mark_dirty(field);
+        is_restart_pending = true;
+        timer = app_timer_register(0, s_restart_prepare_callback, NULL);
     }
-    generation++;
 }
 
 static void s_tick_handler(struct tm *tick_time, TimeUnits units_changed) {
     if ((units_changed & MINUTE_UNIT) == MINUTE_UNIT) {
-        s_timer_stop();
-        s_menu_select_callback(CP_Clock, field_settings);
+        if (is_probe_pending == true) {
+            // the seed was sized before the probe
+            s_probe_if_pending();
+            is_clock_prepared = false;
+        }
+        if ((is_clock_prepared == true) && (field_commit(field) == true)) {
+            // only a swap to the seed
+            is_clock_prepared = false;
+            generation = 0;
+            is_evolution = true;
+            action_bar.created_time = 0;
+        } else {
+            s_timer_stop();
+            s_menu_select_callback(CP_Clock, field_settings);
+        }
     } else {
+        if ((PREPARE_CLOCK_SEC <= tick_time->tm_sec) && (is_clock_prepared == false)) {
+            time_t next_minute = time(NULL) + (60 - tick_time->tm_sec);
+            is_clock_prepared = field_prepare_clock(field, &field_settings, next_minute);
+        }
         switch (generation) {
         case 0: // fall down
         case 2:
@@ -90,7 +256,11 @@ static void s_timer_start(void) {
         if (pattern == CP_Clock) {
             tick_timer_service_subscribe(SECOND_UNIT | MINUTE_UNIT, s_tick_handler);
             timer = TIMER_TICK_TIMER;
+        } else if (is_restart_pending == true) {
+            // the restart was stopped halfway, e.g. by a lost focus
+            timer = app_timer_register(0, s_restart_prepare_callback, NULL);
         } else {
+            s_scheduler_start(DELAY_AUTO_EVO_START_BY_UP);
             timer = app_timer_register(DELAY_AUTO_EVO_START_BY_UP, s_timer_callback, NULL);
         }
     }
@@ -111,21 +281,97 @@ static bool s_is_timer_running(void) {
     return timer == NULL ? false : true;
 }
 
+// Pauses while a notification or the like covers the app, and then
+// evolves the missed generations at once without drawing them.
+static void s_focus_handler(bool in_focus) {
+    if (in_focus == false) {
+        focus.is_paused = s_is_timer_running();
+        if (focus.is_paused == true) {
+            s_timer_stop();
+            focus.paused_time = s_time_get_msec();
+        }
+    } else if (focus.is_paused == true) {
+        focus.is_paused = false;
+        if (pattern == CP_Clock) {
+            // the time may have changed
+            s_field_init(CP_Clock);
+        } else {
+            uint32_t missed = (s_time_get_msec() - focus.paused_time) / (1000 / settings.frame_rate);
+            missed *= s_scheduler_generations_per_frame();
+            if (MAX_CATCHUP_GENERATIONS < missed) {
+                missed = MAX_CATCHUP_GENERATIONS;
+            }
+            for (; (missed > 0) && (is_evolution == true); missed--) {
+                is_evolution = field_evolution_without_render(field);
+                generation++;
+            }
+            field_mark_dirty(field);
+        }
+        // the speed is measured again from the first frame
+        scheduler.slice_rows = DEFAULT_SLICE_ROWS;
+        scheduler.generation_msec = 0;
+        scheduler.last_generation_msec = 0;
+        s_timer_start();
+    }
+}
+
 static void s_field_init(CPattern _pattern) {
     pattern = _pattern;
+    is_clock_prepared = false;
+    is_restart_pending = false;
     generation = 0;
     is_evolution = true;
     field_set_pattern(field, pattern);
 }
 
-static void s_menu_select_callback(CPattern _pattern, FieldSettings settings) {
-    field_settings = settings;
+// The cell size comes from the menu, the rest from the settings.
+static void s_menu_select_callback(CPattern _pattern, FieldSettings _settings) {
+    menu_settings = _settings;
+    field_settings = settings.field;
+    field_settings.cell_size = _settings.cell_size;
+    if (field_settings.is_draw_grid == DRAW_GRID_RANDOM) {
+        field_settings.is_draw_grid = _settings.is_draw_grid;
+    }
     (void)field_reset(field, &field_settings);    
     s_field_init(_pattern);
     s_timer_start();
     action_bar.created_time = 0;
 }
 
+// Only a change of the field settings starts the run over, with what was
+// last chosen from the menu. The others apply to the present run.
+static void s_settings_changed_callback(const Settings *_settings) {
+    bool is_field_changed = false;
+
+    if ((settings.field.cell_size != _settings->field.cell_size)
+        || (settings.field.is_draw_grid != _settings->field.is_draw_grid)
+        || (settings.field.engine != _settings->field.engine)
+        || (settings.field.max_period != _settings->field.max_period)) {
+        is_field_changed = true;
+    }
+    if (settings.frame_rate != _settings->frame_rate) {
+        is_probe_pending = true;
+    }
+    settings = *_settings;
+    settings_save(&settings);
+    if (is_field_changed == true) {
+        s_menu_select_callback(pattern, menu_settings);
+    } else {
+        // the scheduler starts over at the new frame rate
+        s_timer_stop();
+        s_timer_start();
+    }
+}
+
+static void s_settings_callback(void) {
+    if (settings_window == NULL) {
+        settings_window = settings_window_create(s_settings_changed_callback);
+    }
+    if (settings_window != NULL) {
+        settings_window_show(settings_window, &settings);
+    }
+}
+
 static void s_action_bar_destroy(void) {
     action_bar.timer = NULL;
 
@@ -165,9 +411,20 @@ static void s_action_bar_set_icon(ButtonId button) {
     }
 }
 
+// The icons are only needed once a button is pressed.
+static void s_action_bar_load_icons(void) {
+    if (action_bar.icons[ABI_RESET] == NULL) {
+        action_bar.icons[ABI_RESET]   = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_RESET);
+        action_bar.icons[ABI_START]   = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_START);
+        action_bar.icons[ABI_STOP]    = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_STOP);
+        action_bar.icons[ABI_FORWARD] = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_FORWARD);
+    }
+}
+
 static void s_action_bar_create(void) {
     if (action_bar.layer == NULL) {
         if (DELAY_ACTIONBAR_RECREATE < (time(NULL) - action_bar.created_time)) {
+            s_action_bar_load_icons();
             action_bar.layer = action_bar_layer_create();
             s_action_bar_set_icon(BUTTON_ID_UP);
             s_action_bar_set_icon(BUTTON_ID_SELECT);
@@ -208,7 +465,12 @@ static void s_select_long_click_handler(ClickRecognizerRef recognizer, void *con
     last_clicked = BUTTON_ID_SELECT;
 
     s_timer_stop();
-    (void)menu_create(pattern, s_menu_select_callback);
+    if (menu == NULL) {
+        menu = menu_create(s_menu_select_callback, s_settings_callback);
+    }
+    if (menu != NULL) {
+        menu_show(menu, pattern);
+    }
 }
 
 static void s_down_single_click_handler(ClickRecognizerRef recognizer, void *context) {
@@ -231,20 +493,49 @@ static void s_config_provider(void *context) {
     window_single_repeating_click_subscribe(BUTTON_ID_DOWN, DELAY_MANUAL_EVO, s_down_single_click_handler);
 }
 
+// Leaves half of each frame for drawing.
+static uint16_t s_probe_budget(void) {
+    return (1000 / settings.frame_rate) / 2;
+}
+
+// Probes the engine and the cell sizes, and keeps the results for the
+// later launches. It takes a while, so it is done only where a run starts
+// over anyway.
+static void s_probe_if_pending(void) {
+    FieldProbe probe;
+
+    if (is_probe_pending == true) {
+        field_probe(field, s_probe_budget(), &probe);
+        settings_save_probe(&probe);
+        is_probe_pending = false;
+        (void)field_reset(field, &field_settings);
+    }
+}
+
 static void s_window_load(Window *window) {
     pattern = CP_Clock;
+    menu = NULL;
+    settings_window = NULL;
+    settings_load(&settings);
     timer = NULL;
     last_clicked = BUTTON_ID_BACK;
+    is_clock_prepared = false;
+    is_probe_pending = true;
+    is_restart_pending = false;
     srand(time(NULL));
+    cells_set_random_seed(time(NULL));
+    focus.is_paused = false;
+    scheduler.slice_rows = DEFAULT_SLICE_ROWS;
+    scheduler.generation_msec = 0;
+    scheduler.last_generation_msec = 0;
 
     // for action bar
     action_bar.layer = NULL;
     action_bar.timer = NULL;
     action_bar.created_time = 0;
-    action_bar.icons[ABI_RESET]   = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_RESET);
-    action_bar.icons[ABI_START]   = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_START);
-    action_bar.icons[ABI_STOP]    = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_STOP);
-    action_bar.icons[ABI_FORWARD] = gbitmap_create_with_resource(RESOURCE_ID_ACTION_BAR_ICON_FORWARD);
+    for (int i = 0; i < MAX_ACTIONBAR_ICONS; i++) {
+        action_bar.icons[i] = NULL;
+    }
 
     // for field
     Layer *window_layer = window_get_root_layer(window);
@@ -252,17 +543,38 @@ static void s_window_load(Window *window) {
     if (field != NULL) {
         window_set_click_config_provider(window, s_config_provider);
         layer_add_child(window_layer, field_get_layer(field));
-        s_menu_select_callback(CP_Clock, (FieldSettings){DEFAULT_CELL_SIZE, DEFAULT_IS_DRAW_GRID});
+#if RECORD_RUNS
+        (void)field_set_recording(field, true);
+#endif
+        field_set_profiling(field, PROFILE_RENDER);
+        app_focus_service_subscribe(s_focus_handler);
+        FieldProbe probe;
+        if ((settings_load_probe(&probe) == true) && (probe.budget_ms == s_probe_budget())) {
+            field_set_probe(field, &probe);
+            is_probe_pending = false;
+        }
+        s_menu_select_callback(CP_Clock, (FieldSettings){DEFAULT_CELL_SIZE, DEFAULT_IS_DRAW_GRID, ENGINE_AUTO, 0});
     }
 }
 
 static void s_window_unload(Window *window) {
+    // for focus
+    app_focus_service_unsubscribe();
+
+    // for menu
+    settings_window_destroy(settings_window);
+    settings_window = NULL;
+    menu_destroy(menu);
+    menu = NULL;
+
     // for field
     field_destroy(field);
     
     // for action bar
     for (int i = 0; i < MAX_ACTIONBAR_ICONS; i++) {
-        gbitmap_destroy(action_bar.icons[i]);
+        if (action_bar.icons[i] != NULL) {
+            gbitmap_destroy(action_bar.icons[i]);
+        }
     }
 }
 
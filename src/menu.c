@@ -3,7 +3,7 @@
 
 #define NUM_MENU_SECTIONS       (3)
 #define NUM_MENU_SECTION1_ROWS  (1)
-#define NUM_MENU_SECTION2_ROWS  (3)
+#define NUM_MENU_SECTION2_ROWS  (4)
 #define NUM_MENU_SECTION3_ROWS  (1)
 
 typedef struct menu {
@@ -13,31 +13,31 @@ typedef struct menu {
     GBitmap *setting_icon;
     MenuIndex selected_index;
     MenuSelectCallback callback;
+    MenuSettingsCallback settings_callback;
 } Menu;
 
 static void s_window_load(Window *window);
 static void s_window_unload(Window *window);
 static MenuIndex s_menu_get_index_from_pattern(CPattern pattern);
 
-Menu *menu_create(CPattern now_pattern, MenuSelectCallback callback) {
+Menu *menu_create(MenuSelectCallback callback, MenuSettingsCallback settings_callback) {
     Menu *menu = NULL;
 
     menu = calloc(1, sizeof(Menu));
     if (menu != NULL) {
         menu->callback = callback;
+        menu->settings_callback = settings_callback;
 
         Window *window = window_create();
         if (window != NULL) {
             menu->window = window;
  
-            // calc index
-            menu->selected_index = s_menu_get_index_from_pattern(now_pattern);
-            
-            // create icons
+            // create icons (kept until menu_destroy() so that menu_show() is only a window push)
             menu->pattern_icons[CP_Clock] = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_CLOCK);
             menu->pattern_icons[CP_Glider] = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_GLIDER);
             menu->pattern_icons[CP_Saceship] = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_LWSS);
             menu->pattern_icons[CP_RRntomino] = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_RPENT);
+            menu->pattern_icons[CP_Soup] = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_SOUP);
             menu->setting_icon = gbitmap_create_with_resource(RESOURCE_ID_MENU_ICON_SETTING);
 
             // init window
@@ -47,7 +47,6 @@ Menu *menu_create(CPattern now_pattern, MenuSelectCallback callback) {
                 .load = s_window_load,
                 .unload = s_window_unload,
             });
-            window_stack_push(window, true /* Animated */);
         } else {
             menu_destroy(menu);
             menu = NULL;
@@ -61,18 +60,26 @@ void menu_destroy(Menu *menu) {
         return;
     }
     if (menu->window != NULL) {
-        window_stack_pop(true);
+        if (window_stack_contains_window(menu->window) == true) {
+            window_stack_remove(menu->window, false);
+        }
         window_destroy(menu->window);
 
         gbitmap_destroy(menu->pattern_icons[CP_Clock]);
         gbitmap_destroy(menu->pattern_icons[CP_Glider]);
         gbitmap_destroy(menu->pattern_icons[CP_Saceship]);
         gbitmap_destroy(menu->pattern_icons[CP_RRntomino]);
+        gbitmap_destroy(menu->pattern_icons[CP_Soup]);
         gbitmap_destroy(menu->setting_icon);
     }
     free(menu);
 }
 
+void menu_show(Menu *menu, CPattern now_pattern) {
+    menu->selected_index = s_menu_get_index_from_pattern(now_pattern);
+    window_stack_push(menu->window, true /* Animated */);
+}
+
 static uint16_t s_menu_get_num_sections_callback(MenuLayer *menu_layer, void *data) {
     return NUM_MENU_SECTIONS;
 }
@@ -113,10 +120,11 @@ static void s_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, Men
     const struct basic_cell cells2[NUM_MENU_SECTION2_ROWS] = {
         {"Glider", "Popular glider", menu->pattern_icons[CP_Glider]},
         {"Spaceship", "Heavy,Mid,Light", menu->pattern_icons[CP_Saceship]},
-        {"R-pentomino", "Not stabilize", menu->pattern_icons[CP_RRntomino]}
+        {"R-pentomino", "Not stabilize", menu->pattern_icons[CP_RRntomino]},
+        {"Soup", "Random cells", menu->pattern_icons[CP_Soup]}
     };
     const struct basic_cell cells3[NUM_MENU_SECTION3_ROWS] = {
-        {"Settings", "Not supported yet", menu->setting_icon}
+        {"Settings", "Speed, engine, grid", menu->setting_icon}
     };
     const struct basic_cell *cells[NUM_MENU_SECTIONS] = {
         cells1,
@@ -138,7 +146,8 @@ static void s_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index,
         const CPattern patterns2[NUM_MENU_SECTION2_ROWS] = {
             CP_Glider,
             CP_Saceship,
-            CP_RRntomino 
+            CP_RRntomino,
+            CP_Soup
         };
         const CPattern *patterns[NUM_MENU_SECTIONS] = {
             patterns1,
@@ -148,12 +157,13 @@ static void s_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index,
 
         // settings
         const FieldSettings settings1[NUM_MENU_SECTION1_ROWS] = {
-            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM}
+            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, 0}
         };
         const FieldSettings settings2[NUM_MENU_SECTION2_ROWS] = {
-            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM},
-            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM},
-            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM}
+            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, 0},
+            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, 0},
+            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, 0},
+            {CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, 0}
         };
         const FieldSettings *settings[NUM_MENU_SECTIONS] = {
             settings1,
@@ -163,9 +173,12 @@ static void s_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index,
 
         (*menu->callback)(*pattern, *setting);
 
-        menu_destroy(menu);
+        window_stack_remove(menu->window, true);
     } else { // cell_index->section == 2
-        
+        // the settings window comes over the menu, which is then taken away from under it
+        (*menu->settings_callback)();
+
+        window_stack_remove(menu->window, false);
     }
 }
 
@@ -200,7 +213,8 @@ static MenuIndex s_menu_get_index_from_pattern(CPattern pattern) {
         (MenuIndex){0, 0},
         (MenuIndex){1, 0},
         (MenuIndex){1, 1},
-        (MenuIndex){1, 2}
+        (MenuIndex){1, 2},
+        (MenuIndex){1, 3}
     };
     return indexs[(int)pattern];
 }
@@ -7,6 +7,8 @@
 typedef struct menu Menu;
 
 typedef void (*MenuSelectCallback)(CPattern pattern, FieldSettings settings);
+typedef void (*MenuSettingsCallback)(void);
 
-Menu *menu_create(CPattern now_pattern, MenuSelectCallback callback);
+Menu *menu_create(MenuSelectCallback callback, MenuSettingsCallback settings_callback);
 void menu_destroy(Menu *menu);
+void menu_show(Menu *menu, CPattern now_pattern);
@@ -0,0 +1,111 @@
+#include <pebble.h>
+#include "recorder.h"
+
+#if RECORD_RUNS
+
+#define RECORD_KEYFRAME     ('K')
+#define RECORD_DELTA        ('D')
+
+typedef struct recorder {
+    uint16_t sequence;      // of the next chunk
+    uint8_t length;
+    uint8_t chunk[RECORDER_CHUNK_SIZE];
+} Recorder;
+
+static void s_put_byte(Recorder *recorder, uint8_t byte);
+static void s_put_uint16(Recorder *recorder, uint16_t value);
+static void s_put_uint32(Recorder *recorder, uint32_t value);
+static void s_put_varint(Recorder *recorder, uint32_t value);
+
+Recorder *recorder_create(void) {
+    return calloc(1, sizeof(Recorder));
+}
+
+void recorder_destroy(Recorder *recorder) {
+    if (recorder == NULL) {
+        return;
+    }
+    recorder_flush(recorder);
+    free(recorder);
+}
+
+void recorder_keyframe(Recorder *recorder, const Cells *cells) {
+    CSize size = cells_get_size(cells);
+    uint32_t bits[CELLS_ROW_WORDS(size.column)];
+
+    s_put_byte(recorder, RECORD_KEYFRAME);
+    s_put_uint16(recorder, size.row);
+    s_put_uint16(recorder, size.column);
+    for (int row = 0; row < size.row; row++) {
+        cells_get_row(cells, row, bits);
+        for (int word = 0; word < CELLS_ROW_WORDS(size.column); word++) {
+            s_put_uint32(recorder, bits[word]);
+        }
+    }
+}
+
+void recorder_delta(Recorder *recorder, const Cells *cells) {
+    CSize size = cells_get_size(cells);
+    int words = CELLS_ROW_WORDS(size.column);
+    uint32_t bits[words];
+    int last = -1;
+
+    s_put_byte(recorder, RECORD_DELTA);
+    for (int row = 0; row < size.row; row++) {
+        cells_get_row_changes(cells, row, bits);
+        for (int word = 0; word < words; word++) {
+            if (bits[word] != 0) {
+                int index = (row * words) + word;
+                s_put_varint(recorder, index - last);
+                s_put_uint32(recorder, bits[word]);
+                last = index;
+            }
+        }
+    }
+    s_put_varint(recorder, 0);
+}
+
+void recorder_flush(Recorder *recorder) {
+    static const char hex[] = "0123456789abcdef";
+    char line[(RECORDER_CHUNK_SIZE * 2) + 1];
+
+    if (recorder->length == 0) {
+        return;
+    }
+    for (int i = 0; i < recorder->length; i++) {
+        line[(i * 2)] = hex[recorder->chunk[i] >> 4];
+        line[(i * 2) + 1] = hex[recorder->chunk[i] & 0x0F];
+    }
+    line[recorder->length * 2] = '\0';
+    APP_LOG(APP_LOG_LEVEL_INFO, "REC %u %s", recorder->sequence, line);
+    recorder->sequence++;
+    recorder->length = 0;
+}
+
+static void s_put_byte(Recorder *recorder, uint8_t byte) {
+    recorder->chunk[recorder->length++] = byte;
+    if (recorder->length == RECORDER_CHUNK_SIZE) {
+        recorder_flush(recorder);
+    }
+}
+
+static void s_put_uint16(Recorder *recorder, uint16_t value) {
+    s_put_byte(recorder, value & 0xFF);
+    s_put_byte(recorder, value >> 8);
+}
+
+static void s_put_uint32(Recorder *recorder, uint32_t value) {
+    s_put_uint16(recorder, value & 0xFFFF);
+    s_put_uint16(recorder, value >> 16);
+}
+
+// 7 bits in a byte, the top bit set if more bytes follow
+static void s_put_varint(Recorder *recorder, uint32_t value) {
+    while (value >= 0x80) {
+        s_put_byte(recorder, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    s_put_byte(recorder, value);
+}
+
+#endif // RECORD_RUNS
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <pebble.h>
+#include "cells.h"
+
+// A run is logged as lines "REC <sequence> <hex>", RECORDER_CHUNK_SIZE
+// bytes at most in a line. Joined in order, the bytes are a stream of:
+//   'K' rows(2) columns(2) words(4 each)   the whole grid, row by row
+//   'D' { gap(varint) xor(4) }... 0        the words changed from the last frame
+// All numbers are little endian. 'gap' is the distance from the previous
+// changed word (from -1 at the start of a frame), counted in the words of
+// the grid laid out as in the keyframe.
+// tools/replay decodes the lines and replays them through the engine.
+#define RECORDER_CHUNK_SIZE     (48)
+
+// 1 builds the recorder in and records every run. With 0 the recorder is
+// left out of the app and the calls below do nothing.
+#ifndef RECORD_RUNS
+#define RECORD_RUNS             (0)
+#endif
+
+typedef struct recorder Recorder;
+
+#if RECORD_RUNS
+Recorder *recorder_create(void);
+void recorder_destroy(Recorder *recorder);
+void recorder_keyframe(Recorder *recorder, const Cells *cells);
+void recorder_delta(Recorder *recorder, const Cells *cells);
+void recorder_flush(Recorder *recorder);
+#else
+inline static Recorder *recorder_create(void) { return NULL; }
+inline static void recorder_destroy(Recorder *recorder) {}
+inline static void recorder_keyframe(Recorder *recorder, const Cells *cells) {}
+inline static void recorder_delta(Recorder *recorder, const Cells *cells) {}
+inline static void recorder_flush(Recorder *recorder) {}
+#endif
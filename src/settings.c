@@ -0,0 +1,254 @@
+#include <pebble.h>
+#include "settings.h"
+
+#define PERSIST_KEY_VERSION     (1)
+#define PERSIST_KEY_SETTINGS    (2)
+#define PERSIST_KEY_PROBE       (3)
+#define SETTINGS_VERSION        (2)
+
+typedef enum {
+    SR_FrameRate = 0,
+    SR_Speed,
+    SR_RunEnd,
+    SR_Engine,
+    SR_MaxPeriod,
+    SR_DrawGrid
+    // You have to modify 'MAX_SETTINGS_ROWS' value.
+} SettingsRow;
+#define MAX_SETTINGS_ROWS   ((int)SR_DrawGrid + 1)
+
+static const uint8_t s_frame_rates[] = {1, 2, 5, 10};
+static const uint8_t s_generations_per_frames[] = {1, 2, 4, 8, 0};
+static const uint8_t s_max_periods[] = {1, 2, 6, 15, CELLS_MAX_PERIOD};
+#define NUM_FRAME_RATES     (sizeof(s_frame_rates) / sizeof(s_frame_rates[0]))
+#define NUM_GENERATIONS_PER_FRAMES  (sizeof(s_generations_per_frames) / sizeof(s_generations_per_frames[0]))
+#define NUM_MAX_PERIODS     (sizeof(s_max_periods) / sizeof(s_max_periods[0]))
+
+typedef struct settings_window {
+    Window *window;
+    MenuLayer *layer;
+    Settings settings;      // being edited
+    bool is_changed;
+    SettingsChangedCallback callback;
+} SettingsWindow;
+
+static void s_settings_default(Settings *settings);
+static bool s_settings_is_valid(const Settings *settings);
+static int s_index_of(const uint8_t *values, int num_values, uint8_t value);
+static void s_window_load(Window *window);
+static void s_window_unload(Window *window);
+
+void settings_load(Settings *settings) {
+    Settings loaded;
+
+    s_settings_default(settings);
+    if (persist_read_int(PERSIST_KEY_VERSION) == SETTINGS_VERSION) {
+        if ((persist_read_data(PERSIST_KEY_SETTINGS, &loaded, sizeof(Settings)) == (int)sizeof(Settings)) && (s_settings_is_valid(&loaded) == true)) {
+            *settings = loaded;
+        }
+    }
+}
+
+void settings_save(const Settings *settings) {
+    persist_write_int(PERSIST_KEY_VERSION, SETTINGS_VERSION);
+    persist_write_data(PERSIST_KEY_SETTINGS, settings, sizeof(Settings));
+}
+
+// The probe depends only on the watch, so it is done once, not at every launch.
+bool settings_load_probe(FieldProbe *probe) {
+    if (persist_read_int(PERSIST_KEY_VERSION) != SETTINGS_VERSION) {
+        return false;
+    }
+    return persist_read_data(PERSIST_KEY_PROBE, probe, sizeof(FieldProbe)) == (int)sizeof(FieldProbe) ? true : false;
+}
+
+void settings_save_probe(const FieldProbe *probe) {
+    persist_write_int(PERSIST_KEY_VERSION, SETTINGS_VERSION);
+    persist_write_data(PERSIST_KEY_PROBE, probe, sizeof(FieldProbe));
+}
+
+SettingsWindow *settings_window_create(SettingsChangedCallback callback) {
+    SettingsWindow *settings_window = NULL;
+
+    settings_window = calloc(1, sizeof(SettingsWindow));
+    if (settings_window != NULL) {
+        settings_window->callback = callback;
+
+        Window *window = window_create();
+        if (window != NULL) {
+            settings_window->window = window;
+
+            // init window
+            window_set_background_color(window, GColorWhite);
+            window_set_user_data(window, (void*)settings_window);
+            window_set_window_handlers(window, (WindowHandlers) {
+                .load = s_window_load,
+                .unload = s_window_unload,
+            });
+        } else {
+            settings_window_destroy(settings_window);
+            settings_window = NULL;
+        }
+    }
+    return settings_window;
+}
+
+void settings_window_destroy(SettingsWindow *settings_window) {
+    if (settings_window == NULL) {
+        return;
+    }
+    if (settings_window->window != NULL) {
+        settings_window->is_changed = false;    // not applied while the app is closing
+        if (window_stack_contains_window(settings_window->window) == true) {
+            window_stack_remove(settings_window->window, false);
+        }
+        window_destroy(settings_window->window);
+    }
+    free(settings_window);
+}
+
+void settings_window_show(SettingsWindow *settings_window, const Settings *settings) {
+    settings_window->settings = *settings;
+    settings_window->is_changed = false;
+    window_stack_push(settings_window->window, true /* Animated */);
+}
+
+static uint16_t s_menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+    return MAX_SETTINGS_ROWS;
+}
+
+static void s_menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
+    SettingsWindow *settings_window = (SettingsWindow*)data;
+    const Settings *settings = &settings_window->settings;
+    const char *titles[MAX_SETTINGS_ROWS] = {
+        "Frame rate",
+        "Speed",
+        "When a run ends",
+        "Engine",
+        "History depth",
+        "Grid"
+    };
+    const char *run_ends[] = {"Restart", "Stop, save battery"};
+    const char *engines[] = {"Auto", "Word", "Change list"};
+    const char *grids[] = {"Random", "On", "Off"};
+    char sub_title[24];
+
+    switch ((SettingsRow)cell_index->row) {
+    case SR_FrameRate:
+        snprintf(sub_title, sizeof(sub_title), "%d fps", settings->frame_rate);
+        break;
+    case SR_Speed:
+        if (settings->generations_per_frame == 0) {
+            snprintf(sub_title, sizeof(sub_title), "Auto");
+        } else {
+            snprintf(sub_title, sizeof(sub_title), "%d gen. a frame", settings->generations_per_frame);
+        }
+        break;
+    case SR_RunEnd:
+        snprintf(sub_title, sizeof(sub_title), "%s", run_ends[settings->run_end]);
+        break;
+    case SR_Engine:
+        snprintf(sub_title, sizeof(sub_title), "%s", engines[settings->field.engine]);
+        break;
+    case SR_MaxPeriod:
+        if (settings->field.max_period == 1) {
+            snprintf(sub_title, sizeof(sub_title), "Still lifes only");
+        } else {
+            snprintf(sub_title, sizeof(sub_title), "Cycles up to %d", settings->field.max_period);
+        }
+        break;
+    case SR_DrawGrid: // fall down
+    default:
+        snprintf(sub_title, sizeof(sub_title), "%s", grids[settings->field.is_draw_grid]);
+        break;
+    }
+    menu_cell_basic_draw(ctx, cell_layer, titles[cell_index->row], sub_title, NULL);
+}
+
+// Each click steps the setting to its next value.
+static void s_menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
+    SettingsWindow *settings_window = (SettingsWindow*)data;
+    Settings *settings = &settings_window->settings;
+
+    switch ((SettingsRow)cell_index->row) {
+    case SR_FrameRate:
+        settings->frame_rate = s_frame_rates[(s_index_of(s_frame_rates, NUM_FRAME_RATES, settings->frame_rate) + 1) % NUM_FRAME_RATES];
+        break;
+    case SR_Speed:
+        settings->generations_per_frame = s_generations_per_frames[(s_index_of(s_generations_per_frames, NUM_GENERATIONS_PER_FRAMES, settings->generations_per_frame) + 1) % NUM_GENERATIONS_PER_FRAMES];
+        break;
+    case SR_RunEnd:
+        settings->run_end = settings->run_end == RUN_END_RESTART ? RUN_END_STOP : RUN_END_RESTART;
+        break;
+    case SR_Engine:
+        settings->field.engine = (settings->field.engine + 1) % (ENGINE_CHANGE_LIST + 1);
+        break;
+    case SR_MaxPeriod:
+        settings->field.max_period = s_max_periods[(s_index_of(s_max_periods, NUM_MAX_PERIODS, settings->field.max_period) + 1) % NUM_MAX_PERIODS];
+        break;
+    case SR_DrawGrid: // fall down
+    default:
+        settings->field.is_draw_grid = (settings->field.is_draw_grid + 1) % (DRAW_GRID_FALSE + 1);
+        break;
+    }
+    settings_window->is_changed = true;
+    menu_layer_reload_data(menu_layer);
+}
+
+static void s_window_load(Window *window) {
+    SettingsWindow *settings_window = window_get_user_data(window);
+
+    Layer *window_layer = window_get_root_layer(window);
+
+    settings_window->layer = menu_layer_create(layer_get_frame(window_layer));
+    menu_layer_set_callbacks(settings_window->layer, (void*)settings_window, (MenuLayerCallbacks){
+        .get_num_rows = s_menu_get_num_rows_callback,
+        .draw_row = s_menu_draw_row_callback,
+        .select_click = s_menu_select_callback,
+    });
+    menu_layer_set_click_config_onto_window(settings_window->layer, window);
+    layer_add_child(window_layer, menu_layer_get_layer(settings_window->layer));
+}
+
+// The settings are applied when the window is closed.
+static void s_window_unload(Window *window) {
+    SettingsWindow *settings_window = window_get_user_data(window);
+
+    menu_layer_destroy(settings_window->layer);
+    if (settings_window->is_changed == true) {
+        settings_window->is_changed = false;
+        (*settings_window->callback)(&settings_window->settings);
+    }
+}
+
+static void s_settings_default(Settings *settings) {
+    settings->frame_rate = DEFAULT_FRAME_RATE;
+    settings->run_end = RUN_END_RESTART;
+    settings->generations_per_frame = 1;
+    settings->field = (FieldSettings){CELL_SIZE_RANDOM, DRAW_GRID_RANDOM, ENGINE_AUTO, CELLS_MAX_PERIOD};
+}
+
+static bool s_settings_is_valid(const Settings *settings) {
+    if (s_index_of(s_frame_rates, NUM_FRAME_RATES, settings->frame_rate) < 0) {
+        return false;
+    }
+    if (s_index_of(s_generations_per_frames, NUM_GENERATIONS_PER_FRAMES, settings->generations_per_frame) < 0) {
+        return false;
+    }
+    if (s_index_of(s_max_periods, NUM_MAX_PERIODS, settings->field.max_period) < 0) {
+        return false;
+    }
+    if ((RUN_END_STOP < settings->run_end) || (ENGINE_CHANGE_LIST < settings->field.engine) || (DRAW_GRID_FALSE < settings->field.is_draw_grid)) {
+        return false;
+    }
+    return true;
+}
+
+static int s_index_of(const uint8_t *values, int num_values, uint8_t value) {
+    for (int i = 0; i < num_values; i++) {
+        if (values[i] == value) {
+            return i;
+        }
+    }
+    return -1;
+}
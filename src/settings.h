@@ -0,0 +1,29 @@
+#pragma once
+
+#include <pebble.h>
+#include "field.h"
+
+typedef struct settings {
+    uint8_t frame_rate;     // fps
+    enum {
+        RUN_END_RESTART = 0,
+        RUN_END_STOP        // battery saver, wait for a button
+    } run_end;
+    uint8_t generations_per_frame;  // 0 as automatic
+    FieldSettings field;    // 'cell_size' is chosen by the menu
+} Settings;
+
+#define DEFAULT_FRAME_RATE  (5)
+
+typedef struct settings_window SettingsWindow;
+
+typedef void (*SettingsChangedCallback)(const Settings *settings);
+
+void settings_load(Settings *settings);
+void settings_save(const Settings *settings);
+bool settings_load_probe(FieldProbe *probe);
+void settings_save_probe(const FieldProbe *probe);
+
+SettingsWindow *settings_window_create(SettingsChangedCallback callback);
+void settings_window_destroy(SettingsWindow *settings_window);
+void settings_window_show(SettingsWindow *settings_window, const Settings *settings);
@@ -0,0 +1,299 @@
+#include <pebble.h>
+#include "cells.h"
+
+// Checks every engine of src/cells.c against a plain cell-by-cell Life on
+// a torus, on the grid of each cell size and on a few odd widths, and then
+// measures the engines in cells per second.
+//   check           checks only
+//   check --bench   checks, then benchmarks
+
+#define SCREEN_W            (144)
+#define SCREEN_H            (168)
+#define ROUND_SCREEN        (180)
+#define CELL_SIZE_MIN       (2)
+#define CELL_SIZE_MAX       (8)
+#define MAX_GENERATIONS     (600)
+#define HISTORY             (6)     // as the GEN(1..6) planes
+#define MAX_ROWS            (ROUND_SCREEN / CELL_SIZE_MIN)
+#define MAX_COLUMNS         (ROUND_SCREEN / CELL_SIZE_MIN)
+#define BENCH_GENERATIONS   (2000)
+#define SETTLE_GENERATIONS  (1500)
+
+typedef enum {
+    MODE_WHOLE = 0,         // cells_evolution()
+    MODE_STRIPES            // cells_evolution_stripe() in shuffled stripes
+    // You have to modify 'MAX_MODES' value.
+} Mode;
+#define MAX_MODES   ((int)MODE_STRIPES + 1)
+
+typedef struct reference {
+    CSize size;
+    uint8_t cells[MAX_ROWS][MAX_COLUMNS];
+    uint8_t history[HISTORY][MAX_ROWS][MAX_COLUMNS];    // [0] is the last generation
+} Reference;
+
+static const char *s_engine_names[MAX_CENGINE] = {"word", "change list"};
+static const char *s_mode_names[MAX_MODES] = {"whole", "stripes"};
+
+static void s_reference_load(Reference *ref, const Cells *cells) {
+    uint32_t bits[CELLS_ROW_WORDS(MAX_COLUMNS)];
+
+    ref->size = cells_get_size(cells);
+    memset(ref->history, 0x00, sizeof(ref->history));
+    for (int row = 0; row < ref->size.row; row++) {
+        cells_get_row(cells, row, bits);
+        for (int col = 0; col < ref->size.column; col++) {
+            ref->cells[row][col] = (bits[col / 32] >> (col % 32)) & 0x01;
+        }
+    }
+}
+
+// One generation of B3/S23. Returns false when the new generation is one
+// of the last HISTORY ones, as cells_evolution() does.
+static bool s_reference_evolution(Reference *ref) {
+    static uint8_t next[MAX_ROWS][MAX_COLUMNS];
+    int rows = ref->size.row;
+    int cols = ref->size.column;
+
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            int count = 0;
+            for (int dr = -1; dr <= 1; dr++) {
+                for (int dc = -1; dc <= 1; dc++) {
+                    if ((dr != 0) || (dc != 0)) {
+                        count += ref->cells[(row + dr + rows) % rows][(col + dc + cols) % cols];
+                    }
+                }
+            }
+            next[row][col] = ((count == 3) || ((count == 2) && (ref->cells[row][col] == 1))) ? 1 : 0;
+        }
+    }
+    memmove(ref->history[1], ref->history[0], sizeof(ref->history[0]) * (HISTORY - 1));
+    memcpy(ref->history[0], ref->cells, sizeof(ref->cells));
+    memcpy(ref->cells, next, sizeof(next));
+
+    for (int gen = 0; gen < HISTORY; gen++) {
+        bool is_same = true;
+        for (int row = 0; (row < rows) && (is_same == true); row++) {
+            is_same = memcmp(ref->cells[row], ref->history[gen][row], cols) == 0 ? true : false;
+        }
+        if (is_same == true) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool s_reference_equals(const Reference *ref, const Cells *cells) {
+    uint32_t bits[CELLS_ROW_WORDS(MAX_COLUMNS)];
+    int words = CELLS_ROW_WORDS(ref->size.column);
+
+    for (int row = 0; row < ref->size.row; row++) {
+        cells_get_row(cells, row, bits);
+        for (int col = 0; col < ref->size.column; col++) {
+            if (((bits[col / 32] >> (col % 32)) & 0x01) != ref->cells[row][col]) {
+                return false;
+            }
+        }
+        // the bits past the last column are always dead
+        if ((ref->size.column % 32) != 0) {
+            if ((bits[words - 1] >> (ref->size.column % 32)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The stats of the last generation, as cells_get_stats() has them.
+static bool s_reference_stats_equal(const Reference *ref, const Cells *cells) {
+    CStats stats = cells_get_stats(cells);
+    CStats expect = {0, 0, 0, {0, 0}, {0, 0}};
+
+    for (int row = 0; row < ref->size.row; row++) {
+        for (int col = 0; col < ref->size.column; col++) {
+            uint8_t prev = ref->history[0][row][col];
+            uint8_t cell = ref->cells[row][col];
+            expect.births += (cell & ~prev) & 0x01;
+            expect.deaths += (prev & ~cell) & 0x01;
+            if (cell == 0) {
+                continue;
+            }
+            if (expect.population == 0) {
+                expect.min = (CSize){row, col};
+                expect.max = (CSize){row, col};
+            }
+            expect.min.column = col < expect.min.column ? col : expect.min.column;
+            expect.max.row = row;
+            expect.max.column = expect.max.column < col ? col : expect.max.column;
+            expect.population++;
+        }
+    }
+    if ((stats.population != expect.population) || (stats.births != expect.births) || (stats.deaths != expect.deaths)) {
+        return false;
+    }
+    if (expect.population == 0) {
+        return true;
+    }
+    return memcmp(&stats.min, &expect.min, sizeof(CSize)) == 0 && memcmp(&stats.max, &expect.max, sizeof(CSize)) == 0;
+}
+
+static bool s_evolution(Cells *cells, Mode mode) {
+    if (mode == MODE_WHOLE) {
+        return cells_evolution(cells);
+    }
+
+    // stripes of 1 to 8 rows, from the bottom up, with a CStats each
+    static CStats stats[MAX_ROWS];
+    int num_stats = 0;
+    CSize size = cells_get_size(cells);
+    int row_end = size.row;
+    while (row_end > 0) {
+        int rows = (rand() % 8) + 1;
+        int row_begin = row_end < rows ? 0 : row_end - rows;
+        memset(&stats[num_stats], 0x00, sizeof(CStats));
+        cells_evolution_stripe(cells, row_begin, row_end, &stats[num_stats++]);
+        row_end = row_begin;
+    }
+    return cells_evolution_commit(cells, stats, num_stats);
+}
+
+static void s_set_pattern(Cells *cells, int pattern, int seed) {
+    cells_set_random_seed(seed);
+    if (pattern < MAX_CPATTERN) {
+        cells_set_soup_density(DEFAULT_SOUP_DENSITY);
+        cells_set_pattern(cells, (CPattern)pattern);
+    } else {
+        // soups from 10% to 60%
+        cells_set_soup_density(10 + ((pattern - MAX_CPATTERN) * 10));
+        cells_set_pattern(cells, CP_Soup);
+    }
+}
+
+// Runs one pattern until the reference ends it. Returns false on a mismatch.
+static bool s_check_run(Cells *cells, CEngine engine, Mode mode, int pattern, int seed) {
+    static Reference ref;
+    CSize size = cells_get_size(cells);
+
+    // the stats are checked on the stripes, they are merged stripe by stripe
+    bool is_stats = (mode == MODE_STRIPES) ? true : false;
+
+    (void)cells_set_engine(cells, engine);
+    cells_set_max_period(cells, HISTORY);
+    cells_set_stats_enabled(cells, is_stats);
+    s_set_pattern(cells, pattern, seed);
+    s_reference_load(&ref, cells);
+    for (int gen = 0; gen < MAX_GENERATIONS; gen++) {
+        bool is_ref_evolution = s_reference_evolution(&ref);
+        bool is_evolution = s_evolution(cells, mode);
+        if ((s_reference_equals(&ref, cells) == false) || (is_evolution != is_ref_evolution) ||
+                ((is_stats == true) && (s_reference_stats_equal(&ref, cells) == false))) {
+            printf("FAIL %dx%d %s/%s pattern %d seed %d generation %d\n",
+                   size.row, size.column, s_engine_names[engine], s_mode_names[mode], pattern, seed, gen + 1);
+            return false;
+        }
+        if (is_ref_evolution == false) {
+            break;
+        }
+    }
+    return true;
+}
+
+// The patterns are drawn for the screen grids only, the others get soups.
+static int s_check(const CSize *sizes, int num_sizes, int num_screen_sizes) {
+    int fails = 0;
+    int runs = 0;
+
+    for (int i = 0; i < num_sizes; i++) {
+        Cells *cells = cells_create(sizes[i]);
+        if (cells == NULL) {
+            printf("FAIL cells_create(%dx%d)\n", sizes[i].row, sizes[i].column);
+            fails++;
+            continue;
+        }
+        // the soups come after the patterns, see s_set_pattern()
+        for (int pattern = (i < num_screen_sizes ? CP_Clock : MAX_CPATTERN); pattern < (MAX_CPATTERN + 6); pattern++) {
+            for (int engine = 0; engine < MAX_CENGINE; engine++) {
+                for (int mode = 0; mode < MAX_MODES; mode++) {
+                    srand(pattern);
+                    if (s_check_run(cells, (CEngine)engine, (Mode)mode, pattern, i + 1) == false) {
+                        fails++;
+                    }
+                    runs++;
+                }
+            }
+        }
+        cells_destroy(cells);
+    }
+    printf("check: %d runs, %d failed\n", runs, fails);
+    return fails;
+}
+
+static double s_time_get_sec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+// Cells per second of 'generations' generations from a soup, after
+// 'settle' generations which are not measured.
+static double s_bench_run(Cells *cells, CEngine engine, int settle, int generations) {
+    CSize size = cells_get_size(cells);
+
+    (void)cells_set_engine(cells, engine);
+    cells_set_max_period(cells, 1);
+    s_set_pattern(cells, MAX_CPATTERN + 2, 1);
+    for (int gen = 0; gen < settle; gen++) {
+        (void)cells_evolution(cells);
+    }
+    double started = s_time_get_sec();
+    for (int gen = 0; gen < generations; gen++) {
+        (void)cells_evolution(cells);
+    }
+    double elapsed = s_time_get_sec() - started;
+    return ((double)size.row * size.column * generations) / elapsed;
+}
+
+static void s_bench(const CSize *sizes, int num_sizes) {
+    printf("%-9s %-12s %14s %14s\n", "grid", "engine", "fresh Mcell/s", "settled Mcell/s");
+    for (int i = 0; i < num_sizes; i++) {
+        Cells *cells = cells_create(sizes[i]);
+        if (cells == NULL) {
+            continue;
+        }
+        for (int engine = 0; engine < MAX_CENGINE; engine++) {
+            double fresh = s_bench_run(cells, (CEngine)engine, 0, BENCH_GENERATIONS);
+            double settled = s_bench_run(cells, (CEngine)engine, SETTLE_GENERATIONS, BENCH_GENERATIONS);
+            printf("%3dx%-5d %-12s %14.1f %14.1f\n",
+                   sizes[i].row, sizes[i].column, s_engine_names[engine], fresh / 1e6, settled / 1e6);
+        }
+        cells_destroy(cells);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    CSize sizes[((CELL_SIZE_MAX - CELL_SIZE_MIN + 1) * 2) + 5];
+    int num_sizes = 0;
+
+    // as s_calc_layer_frame() in src/field.c, on both screens
+    for (int cell_size = CELL_SIZE_MIN; cell_size <= CELL_SIZE_MAX; cell_size++) {
+        int margin = ((cell_size * 2) - 1) - (cell_size & 0x1);
+        sizes[num_sizes++] = (CSize){(SCREEN_H - margin) / cell_size, (SCREEN_W - margin) / cell_size};
+        sizes[num_sizes++] = (CSize){(ROUND_SCREEN - margin) / cell_size, (ROUND_SCREEN - margin) / cell_size};
+    }
+    int num_screen_sizes = num_sizes;
+
+    // widths at and around the word boundaries
+    sizes[num_sizes++] = (CSize){3, 3};
+    sizes[num_sizes++] = (CSize){8, 31};
+    sizes[num_sizes++] = (CSize){5, 33};
+    sizes[num_sizes++] = (CSize){32, 32};
+    sizes[num_sizes++] = (CSize){10, 64};
+
+    int fails = s_check(sizes, num_sizes, num_screen_sizes);
+    if ((argc > 1) && (strcmp(argv[1], "--bench") == 0)) {
+        s_bench(sizes, num_screen_sizes);
+    }
+    return fails == 0 ? 0 : 1;
+}
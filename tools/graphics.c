@@ -0,0 +1,158 @@
+#include <pebble.h>
+
+// The graphics and the layers of tools/pebble.h. A layer draws only
+// within its frame, from the origin of its frame, as on the watch.
+
+struct Layer {
+    GRect frame;
+    LayerUpdateProc update_proc;
+    uint32_t dirty;         // layer_mark_dirty() calls
+    uint8_t data[] __attribute__((aligned(16)));   // as malloc() aligns
+};
+
+struct GContext {
+    GColor stroke_color;
+    GColor fill_color;
+    GRect clip;             // of the layer being drawn, in the screen
+    GStats stats;
+    uint8_t frame[SCREEN_HEIGHT][SCREEN_WIDTH];
+};
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+    Layer *layer = calloc(1, sizeof(Layer) + data_size);
+
+    if (layer != NULL) {
+        layer->frame = frame;
+    }
+    return layer;
+}
+
+void layer_destroy(Layer *layer) {
+    free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+    return (void*)layer->data;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+    layer->frame = frame;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+    return layer->frame;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+    layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) {
+    layer->dirty++;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+    ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+    ctx->fill_color = color;
+}
+
+static void s_set_pixel(GContext *ctx, int x, int y, GColor color) {
+    x += ctx->clip.origin.x;
+    y += ctx->clip.origin.y;
+    if ((x < ctx->clip.origin.x) || ((ctx->clip.origin.x + ctx->clip.size.w) <= x)
+        || (y < ctx->clip.origin.y) || ((ctx->clip.origin.y + ctx->clip.size.h) <= y)
+        || (x < 0) || (SCREEN_WIDTH <= x) || (y < 0) || (SCREEN_HEIGHT <= y)) {
+        return;
+    }
+    if (color != GColorClear) {
+        ctx->frame[y][x] = (uint8_t)color;
+        ctx->stats.pixels++;
+    }
+}
+
+// Both ends are drawn. field.c draws only horizontal and vertical lines.
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+    int dx = abs(p1.x - p0.x);
+    int dy = -abs(p1.y - p0.y);
+    int sx = p0.x < p1.x ? 1 : -1;
+    int sy = p0.y < p1.y ? 1 : -1;
+    int err = dx + dy;
+    int x = p0.x;
+    int y = p0.y;
+
+    ctx->stats.calls++;
+    while (true) {
+        s_set_pixel(ctx, x, y, ctx->stroke_color);
+        if ((x == p1.x) && (y == p1.y)) {
+            break;
+        }
+        if ((err * 2) >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if ((err * 2) <= dx) {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+    ctx->stats.calls++;
+    for (int y = rect.origin.y; y < (rect.origin.y + rect.size.h); y++) {
+        for (int x = rect.origin.x; x < (rect.origin.x + rect.size.w); x++) {
+            s_set_pixel(ctx, x, y, ctx->fill_color);
+        }
+    }
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (tloc != NULL) {
+        *tloc = now.tv_sec;
+    }
+    if (out_ms != NULL) {
+        *out_ms = now.tv_nsec / 1000000;
+    }
+    return now.tv_nsec / 1000000;
+}
+
+// About what an aplite app has, so that field.c takes its smallest cells.
+size_t heap_bytes_free(void) {
+    return 24 * 1024;
+}
+
+GContext *graphics_create(void) {
+    return calloc(1, sizeof(GContext));
+}
+
+void graphics_destroy(GContext *ctx) {
+    free(ctx);
+}
+
+void graphics_render(GContext *ctx, Layer *layer) {
+    memset(ctx->frame, GColorBlack, sizeof(ctx->frame));
+    ctx->stroke_color = GColorBlack;
+    ctx->fill_color = GColorBlack;
+    ctx->clip = layer->frame;
+    if (layer->update_proc != NULL) {
+        (*layer->update_proc)(layer, ctx);
+    }
+}
+
+const uint8_t *graphics_get_frame(const GContext *ctx) {
+    return &ctx->frame[0][0];
+}
+
+GStats graphics_get_stats(const GContext *ctx) {
+    return ctx->stats;
+}
+
+void graphics_clear_stats(GContext *ctx) {
+    memset(&ctx->stats, 0x00, sizeof(GStats));
+}
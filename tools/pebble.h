@@ -0,0 +1,82 @@
+#pragma once
+
+// A host stand-in for the part of the Pebble SDK used by src/, so that
+// src/cells.c, src/font.c, src/recorder.c and src/field.c build unchanged
+// on a host.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#define APP_LOG_LEVEL_ERROR     (1)
+#define APP_LOG_LEVEL_WARNING   (50)
+#define APP_LOG_LEVEL_INFO      (100)
+#define APP_LOG_LEVEL_DEBUG     (200)
+
+#define APP_LOG(level, fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
+
+// The part of the graphics and the layers used by src/field.c, drawn by
+// tools/graphics.c into a frame buffer of the aplite screen.
+#define SCREEN_WIDTH    (144)
+#define SCREEN_HEIGHT   (168)
+
+typedef struct GPoint {
+    int16_t x;
+    int16_t y;
+} GPoint;
+
+typedef struct GSize {
+    int16_t w;
+    int16_t h;
+} GSize;
+
+typedef struct GRect {
+    GPoint origin;
+    GSize size;
+} GRect;
+
+typedef enum GColor {
+    GColorClear = ~0,
+    GColorBlack = 0,
+    GColorWhite = 1
+} GColor;
+
+typedef enum {
+    GCornerNone = 0
+} GCornerMask;
+
+typedef struct GContext GContext;
+typedef struct Layer Layer;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+
+Layer *layer_create_with_data(GRect frame, size_t data_size);
+void layer_destroy(Layer *layer);
+void *layer_get_data(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_mark_dirty(Layer *layer);
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+size_t heap_bytes_free(void);
+
+// Host only: draws 'layer' as the screen would, on a black background.
+typedef struct GStats {
+    uint32_t calls;         // of graphics_*() drawing
+    uint32_t pixels;        // set by them, as often as they are set
+} GStats;
+
+GContext *graphics_create(void);
+void graphics_destroy(GContext *ctx);
+void graphics_render(GContext *ctx, Layer *layer);
+const uint8_t *graphics_get_frame(const GContext *ctx);    // a byte per pixel, row by row
+GStats graphics_get_stats(const GContext *ctx);
+void graphics_clear_stats(GContext *ctx);
@@ -0,0 +1,208 @@
+#include <pebble.h>
+#include "field.h"
+
+// Draws the field of src/field.c through the graphics of tools/graphics.c
+// for every cell size, grid and pattern. Each frame after GOLDEN_GENERATIONS
+// is checked against its hash in a golden file, then BENCH_FRAMES frames
+// are timed with their graphics calls and pixels.
+//   render GOLDEN             checks and measures
+//   render --update GOLDEN    writes the hashes of the frames drawn now
+//   render --dump DIR         writes the frames as DIR/<cell>-<grid>-<pattern>.pbm
+
+#define GOLDEN_GENERATIONS  (20)
+#define BENCH_FRAMES        (200)
+#define CLOCK_TIME          (45296)     // 12:34:56 UTC
+#define MAX_CONFIGS         ((CELL_SIZE_MAX - CELL_SIZE_MIN + 1) * 2 * MAX_CPATTERN)
+
+typedef enum {
+    MODE_CHECK = 0,
+    MODE_UPDATE,
+    MODE_DUMP
+} Mode;
+
+typedef struct config {
+    int cell_size;
+    bool is_draw_grid;
+    CPattern pattern;
+} Config;
+
+static const char *s_pattern_names[MAX_CPATTERN] = {"none", "clock", "glider", "spaceship", "r-pentomino", "soup"};
+
+// The same frame every time for a config.
+static void s_set_config(Field *field, const Config *config) {
+    FieldSettings settings = {config->cell_size, config->is_draw_grid ? DRAW_GRID_TRUE : DRAW_GRID_FALSE, ENGINE_WORD, 0};
+
+    srand(1);
+    cells_set_random_seed(1);
+    (void)field_reset(field, &settings);
+    if (config->pattern == CP_Clock) {
+        (void)field_prepare_clock(field, &settings, CLOCK_TIME);
+        (void)field_commit(field);
+    } else {
+        field_set_pattern(field, config->pattern);
+    }
+}
+
+// FNV-1a of the frame.
+static uint32_t s_hash_frame(const GContext *ctx) {
+    const uint8_t *frame = graphics_get_frame(ctx);
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < (SCREEN_WIDTH * SCREEN_HEIGHT); i++) {
+        hash = (hash ^ frame[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool s_dump_frame(const GContext *ctx, const char *dir, const Config *config) {
+    const uint8_t *frame = graphics_get_frame(ctx);
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/%d-%s-%s.pbm", dir, config->cell_size,
+             config->is_draw_grid ? "grid" : "plain", s_pattern_names[config->pattern]);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("FAIL cannot write %s\n", path);
+        return false;
+    }
+    // 1 is black in PBM
+    fprintf(file, "P1\n%d %d\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            fputc(frame[(y * SCREEN_WIDTH) + x] == GColorWhite ? '0' : '1', file);
+        }
+        fputc('\n', file);
+    }
+    fclose(file);
+    return true;
+}
+
+static double s_time_get_sec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static void s_bench(Field *field, GContext *ctx, const Config *config) {
+    double elapsed = 0;
+
+    graphics_clear_stats(ctx);
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        (void)field_evolution_without_render(field);
+        double started = s_time_get_sec();
+        graphics_render(ctx, field_get_layer(field));
+        elapsed += s_time_get_sec() - started;
+    }
+    GStats stats = graphics_get_stats(ctx);
+    printf("%4d %-5s %-12s %10.1f %10u %10u\n", config->cell_size, config->is_draw_grid ? "on" : "off",
+           s_pattern_names[config->pattern], (elapsed * 1e6) / BENCH_FRAMES,
+           stats.calls / BENCH_FRAMES, stats.pixels / BENCH_FRAMES);
+}
+
+// Returns the number of configs, the grid is drawn only from cell size 4.
+static int s_make_configs(Config *configs) {
+    int num_configs = 0;
+
+    for (int cell_size = CELL_SIZE_MIN; cell_size <= CELL_SIZE_MAX; cell_size++) {
+        for (int grid = 0; grid < 2; grid++) {
+            if ((grid == 1) && (cell_size <= 3)) {
+                continue;
+            }
+            for (int pattern = CP_Clock; pattern < MAX_CPATTERN; pattern++) {
+                configs[num_configs++] = (Config){cell_size, grid == 1, (CPattern)pattern};
+            }
+        }
+    }
+    return num_configs;
+}
+
+int main(int argc, char *argv[]) {
+    static Config configs[MAX_CONFIGS];
+    uint32_t hashes[MAX_CONFIGS];
+    Mode mode = MODE_CHECK;
+    const char *path;
+    int fails = 0;
+
+    if ((argc == 3) && (strcmp(argv[1], "--update") == 0)) {
+        mode = MODE_UPDATE;
+        path = argv[2];
+    } else if ((argc == 3) && (strcmp(argv[1], "--dump") == 0)) {
+        mode = MODE_DUMP;
+        path = argv[2];
+    } else if (argc == 2) {
+        path = argv[1];
+    } else {
+        printf("usage: render GOLDEN | --update GOLDEN | --dump DIR\n");
+        return 2;
+    }
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    int num_configs = s_make_configs(configs);
+    if (mode == MODE_CHECK) {
+        FILE *file = fopen(path, "r");
+        if (file == NULL) {
+            printf("FAIL cannot read %s\n", path);
+            return 1;
+        }
+        for (int i = 0; i < num_configs; i++) {
+            if (fscanf(file, "%*d %*s %*s %x", &hashes[i]) != 1) {
+                printf("FAIL %s has %d of %d frames\n", path, i, num_configs);
+                fclose(file);
+                return 1;
+            }
+        }
+        fclose(file);
+    }
+
+    Field *field = field_create((GRect){{0, 0}, {SCREEN_WIDTH, SCREEN_HEIGHT}});
+    GContext *ctx = graphics_create();
+    FILE *golden = mode == MODE_UPDATE ? fopen(path, "w") : NULL;
+    if ((field == NULL) || (ctx == NULL) || ((mode == MODE_UPDATE) && (golden == NULL))) {
+        printf("FAIL cannot set up the field\n");
+        return 1;
+    }
+
+    if (mode == MODE_CHECK) {
+        printf("cell grid  pattern        usec/frame calls/frame pixels/frame\n");
+    }
+    for (int i = 0; i < num_configs; i++) {
+        s_set_config(field, &configs[i]);
+        for (int gen = 0; gen < GOLDEN_GENERATIONS; gen++) {
+            (void)field_evolution_without_render(field);
+        }
+        graphics_render(ctx, field_get_layer(field));
+        uint32_t hash = s_hash_frame(ctx);
+
+        switch (mode) {
+        case MODE_UPDATE:
+            fprintf(golden, "%d %s %s %08x\n", configs[i].cell_size, configs[i].is_draw_grid ? "on" : "off",
+                    s_pattern_names[configs[i].pattern], hash);
+            break;
+        case MODE_DUMP:
+            if (s_dump_frame(ctx, path, &configs[i]) == false) {
+                fails++;
+            }
+            break;
+        case MODE_CHECK: // fall down
+        default:
+            if (hash != hashes[i]) {
+                printf("FAIL cell %d grid %s %s differs from the golden frame\n", configs[i].cell_size,
+                       configs[i].is_draw_grid ? "on" : "off", s_pattern_names[configs[i].pattern]);
+                fails++;
+            }
+            s_bench(field, ctx, &configs[i]);
+            break;
+        }
+    }
+    if (golden != NULL) {
+        fclose(golden);
+    }
+    if (mode == MODE_CHECK) {
+        printf("render: %d frames, %d differ from %s\n", num_configs, fails, path);
+    }
+    graphics_destroy(ctx);
+    field_destroy(field);
+    return fails == 0 ? 0 : 1;
+}
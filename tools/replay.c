@@ -0,0 +1,306 @@
+#include <pebble.h>
+#include "cells.h"
+#include "recorder.h"
+
+// Replays the runs logged by src/recorder.c through the engine. Each
+// delta frame is checked against one cells_evolution() of the frame before
+// it, and the population of every frame is kept.
+//   replay < log               checks, then one line per run
+//   replay --curve < log       and "<run> <generation> <population>" per frame
+//   replay --record N [SEED]   logs N generations of soups as the watch
+//                              does, e.g. to be piped into replay
+
+#define MAX_LINE            (512)
+#define RECORD_SIZE         (CSize){82, 70}     // cell size 2 on the 144x168 screen
+
+typedef struct stream {
+    uint8_t *bytes;
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t sequence;      // of the next chunk
+    bool is_broken;         // a chunk is missing, skipped up to the next stream
+} Stream;
+
+typedef struct run {
+    CSize size;
+    uint16_t words;         // per row
+    uint32_t *expect;       // the frame as recorded
+    uint32_t generations;
+    uint32_t population_first;
+    uint32_t population_min;
+    uint32_t population_max;
+    uint32_t mismatches;
+} Run;
+
+typedef struct replay {
+    bool is_curve;
+    Cells *cells;
+    Run run;
+    uint32_t runs;
+    uint32_t errors;        // of the stream, not of the engine
+    uint32_t mismatches;
+} Replay;
+
+static int s_popcount(uint32_t n) {
+    return __builtin_popcount(n);
+}
+
+static uint32_t s_population(const Run *run) {
+    uint32_t population = 0;
+
+    for (uint32_t i = 0; i < (uint32_t)run->words * run->size.row; i++) {
+        population += s_popcount(run->expect[i]);
+    }
+    return population;
+}
+
+static bool s_get_uint16(const Stream *stream, uint32_t *pos, uint16_t *value) {
+    if (stream->length < (*pos + 2)) {
+        return false;
+    }
+    *value = stream->bytes[*pos] | (stream->bytes[*pos + 1] << 8);
+    *pos += 2;
+    return true;
+}
+
+static bool s_get_uint32(const Stream *stream, uint32_t *pos, uint32_t *value) {
+    uint16_t low, high;
+
+    if ((s_get_uint16(stream, pos, &low) == false) || (s_get_uint16(stream, pos, &high) == false)) {
+        return false;
+    }
+    *value = low | ((uint32_t)high << 16);
+    return true;
+}
+
+static bool s_get_varint(const Stream *stream, uint32_t *pos, uint32_t *value) {
+    *value = 0;
+    for (int shift = 0; (shift < 32) && (*pos < stream->length); shift += 7) {
+        uint8_t byte = stream->bytes[(*pos)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void s_run_end(Replay *replay) {
+    Run *run = &replay->run;
+
+    if (run->expect == NULL) {
+        return;
+    }
+    if (replay->is_curve == false) {
+        printf("run %u: %dx%d, %u generations, population %u -> %u (%u..%u)%s\n",
+               replay->runs, run->size.row, run->size.column, run->generations,
+               run->population_first, s_population(run), run->population_min, run->population_max,
+               run->mismatches == 0 ? "" : ", MISMATCH");
+    }
+    replay->mismatches += run->mismatches;
+    free(run->expect);
+    run->expect = NULL;
+}
+
+static void s_run_frame(Replay *replay) {
+    Run *run = &replay->run;
+    uint32_t population = s_population(run);
+
+    if (run->generations == 0) {
+        run->population_first = population;
+        run->population_min = population;
+        run->population_max = population;
+    }
+    run->population_min = population < run->population_min ? population : run->population_min;
+    run->population_max = run->population_max < population ? population : run->population_max;
+    if (replay->is_curve == true) {
+        printf("%u %u %u\n", replay->runs, run->generations, population);
+    }
+}
+
+// 'K': a new run from this grid.
+static bool s_decode_keyframe(Replay *replay, const Stream *stream, uint32_t *pos) {
+    Run *run = &replay->run;
+    CSize size;
+
+    if ((s_get_uint16(stream, pos, &size.row) == false) || (s_get_uint16(stream, pos, &size.column) == false)) {
+        return false;
+    }
+    uint32_t num_words = (uint32_t)CELLS_ROW_WORDS(size.column) * size.row;
+    if (stream->length < (*pos + (num_words * 4))) {
+        return false;
+    }
+    s_run_end(replay);
+    if ((replay->cells == NULL) || (memcmp(&size, &run->size, sizeof(CSize)) != 0)) {
+        cells_destroy(replay->cells);
+        replay->cells = cells_create(size);
+        if (replay->cells == NULL) {
+            return false;
+        }
+    }
+    memset(run, 0x00, sizeof(Run));
+    run->size = size;
+    run->words = CELLS_ROW_WORDS(size.column);
+    run->expect = malloc(sizeof(uint32_t) * num_words);
+    for (uint32_t i = 0; i < num_words; i++) {
+        (void)s_get_uint32(stream, pos, &run->expect[i]);
+    }
+    cells_set_rows(replay->cells, run->expect);
+    replay->runs++;
+    s_run_frame(replay);
+    return true;
+}
+
+// 'D': the next generation, checked against the engine.
+static bool s_decode_delta(Replay *replay, const Stream *stream, uint32_t *pos) {
+    Run *run = &replay->run;
+    uint32_t num_words = (uint32_t)run->words * run->size.row;
+    uint32_t bits[CELLS_ROW_WORDS(UINT16_MAX)];
+    int32_t index = -1;
+    uint32_t gap;
+
+    while (true) {
+        uint32_t xor;
+        if (s_get_varint(stream, pos, &gap) == false) {
+            return false;
+        }
+        if (gap == 0) {
+            break;
+        }
+        index += gap;
+        if ((s_get_uint32(stream, pos, &xor) == false) || (num_words <= (uint32_t)index)) {
+            return false;
+        }
+        run->expect[index] ^= xor;
+    }
+
+    (void)cells_evolution(replay->cells);
+    run->generations++;
+    for (int row = 0; row < run->size.row; row++) {
+        cells_get_row(replay->cells, row, bits);
+        if (memcmp(bits, &run->expect[row * run->words], sizeof(uint32_t) * run->words) != 0) {
+            if (run->mismatches == 0) {
+                printf("run %u: generation %u differs from the engine at row %d\n", replay->runs, run->generations, row);
+            }
+            run->mismatches++;
+            // go on from the recorded frame
+            cells_set_rows(replay->cells, run->expect);
+            break;
+        }
+    }
+    s_run_frame(replay);
+    return true;
+}
+
+// Decodes the records of a whole stream. The last one may be cut short,
+// as the watch logs only full chunks until the recorder is destroyed.
+static void s_decode(Replay *replay, Stream *stream) {
+    uint32_t pos = 0;
+
+    while (pos < stream->length) {
+        uint32_t begin = pos;
+        uint8_t tag = stream->bytes[pos++];
+        bool is_done = false;
+        if (tag == 'K') {
+            is_done = s_decode_keyframe(replay, stream, &pos);
+        } else if ((tag == 'D') && (replay->run.expect != NULL)) {
+            is_done = s_decode_delta(replay, stream, &pos);
+        } else {
+            printf("bad record '%c' at byte %u\n", tag, begin);
+            replay->errors++;
+            break;
+        }
+        if (is_done == false) {
+            printf("record '%c' at byte %u is cut short\n", tag, begin);
+            break;
+        }
+    }
+    s_run_end(replay);
+    stream->length = 0;
+    stream->sequence = 0;
+}
+
+static int s_hex(char c) {
+    if (('0' <= c) && (c <= '9')) {
+        return c - '0';
+    }
+    if (('a' <= c) && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Takes the chunk of a "REC <sequence> <hex>" line, wherever the log
+// puts it in the line. A sequence from 0 again is a new stream.
+static void s_read_line(Replay *replay, Stream *stream, const char *line) {
+    const char *rec = strstr(line, "REC ");
+    unsigned sequence;
+    int offset;
+
+    if ((rec == NULL) || (sscanf(rec, "REC %u %n", &sequence, &offset) != 1)) {
+        return;
+    }
+    if (sequence == 0) {
+        s_decode(replay, stream);
+        stream->is_broken = false;
+    } else if (stream->is_broken == true) {
+        return;
+    } else if (sequence != stream->sequence) {
+        printf("chunk %u is missing\n", stream->sequence);
+        replay->errors++;
+        s_decode(replay, stream);
+        stream->is_broken = true;
+        return;
+    }
+    for (const char *hex = rec + offset; (s_hex(hex[0]) >= 0) && (s_hex(hex[1]) >= 0); hex += 2) {
+        if (stream->length == stream->capacity) {
+            stream->capacity = stream->capacity == 0 ? 4096 : stream->capacity * 2;
+            stream->bytes = realloc(stream->bytes, stream->capacity);
+        }
+        stream->bytes[stream->length++] = (s_hex(hex[0]) << 4) | s_hex(hex[1]);
+    }
+    stream->sequence++;
+}
+
+// The soups a watch left on a clock-less run would log, one run after another.
+static void s_record(int generations, uint32_t seed) {
+    Cells *cells = cells_create(RECORD_SIZE);
+    Recorder *recorder = recorder_create();
+
+    cells_set_random_seed(seed);
+    cells_set_pattern(cells, CP_Soup);
+    recorder_keyframe(recorder, cells);
+    for (int gen = 0; gen < generations; gen++) {
+        bool is_evolution = cells_evolution(cells);
+        recorder_delta(recorder, cells);
+        if (is_evolution == false) {
+            cells_set_pattern(cells, CP_Soup);
+            recorder_keyframe(recorder, cells);
+        }
+    }
+    recorder_destroy(recorder);
+    cells_destroy(cells);
+}
+
+int main(int argc, char *argv[]) {
+    Replay replay = {false, NULL, {{0, 0}, 0, NULL, 0, 0, 0, 0, 0}, 0, 0, 0};
+    Stream stream = {NULL, 0, 0, 0, false};
+    char line[MAX_LINE];
+
+    if ((argc >= 3) && (strcmp(argv[1], "--record") == 0)) {
+        s_record(atoi(argv[2]), argc >= 4 ? strtoul(argv[3], NULL, 0) : 1);
+        return 0;
+    }
+    replay.is_curve = ((argc >= 2) && (strcmp(argv[1], "--curve") == 0)) ? true : false;
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        s_read_line(&replay, &stream, line);
+    }
+    s_decode(&replay, &stream);
+    free(stream.bytes);
+    cells_destroy(replay.cells);
+
+    if (replay.is_curve == false) {
+        printf("replay: %u runs, %u mismatches, %u stream errors\n", replay.runs, replay.mismatches, replay.errors);
+    }
+    return ((replay.runs > 0) && (replay.mismatches == 0) && (replay.errors == 0)) ? 0 : 1;
+}
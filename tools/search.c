@@ -0,0 +1,160 @@
+#include <pebble.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "cells.h"
+
+// Runs soups of consecutive seeds on every cpu until each one settles, and
+// reports the longest-lived ones with their final populations, to choose
+// the seeds a watch starts from. A soup which has not settled after
+// MAX_GENERATIONS, like a glider around the torus, is counted apart.
+//   search                            SEEDS soups from seed 1 on the screen of cell size 2
+//   search COUNT [FIRST [ROWS COLUMNS [DENSITY]]]
+
+#define SEEDS               (4096)
+#define MAX_GENERATIONS     (20000)
+#define MAX_THREADS         (64)
+#define REPORT_LINES        (20)
+#define SEARCH_SIZE         (CSize){82, 70}     // cell size 2 on the 144x168 screen
+
+typedef struct result {
+    uint32_t seed;
+    uint32_t generations;   // up to the generation which settled
+    uint16_t population;    // when settled
+} Result;
+
+typedef struct search {
+    CSize size;
+    uint32_t first_seed;
+    uint32_t count;
+    uint32_t next;          // the index of the next soup to run, taken atomically
+    pthread_mutex_t soup;   // the seed and the generator of src/cells.c are global
+    Result *results;
+} Search;
+
+static void *s_worker_main(void *context) {
+    Search *search = (Search*)context;
+    Cells *cells = cells_create(search->size);
+
+    if (cells == NULL) {
+        return NULL;
+    }
+    (void)cells_set_engine(cells, CE_ChangeList);   // the same cells as CE_Word, sooner once settling
+    cells_set_stats_enabled(cells, true);
+    while (true) {
+        uint32_t index = __atomic_fetch_add(&search->next, 1, __ATOMIC_RELAXED);
+        if (search->count <= index) {
+            break;
+        }
+        Result *result = &search->results[index];
+        result->seed = search->first_seed + index;
+        pthread_mutex_lock(&search->soup);
+        cells_set_random_seed(result->seed);
+        cells_set_pattern(cells, CP_Soup);
+        pthread_mutex_unlock(&search->soup);
+
+        result->generations = 0;
+        while (result->generations < MAX_GENERATIONS) {
+            result->generations++;
+            if (cells_evolution(cells) == false) {
+                break;
+            }
+        }
+        result->population = cells_get_stats(cells).population;
+    }
+    cells_destroy(cells);
+    return NULL;
+}
+
+// The longest first, the lowest seed first among the same.
+static int s_result_compare(const void *a, const void *b) {
+    const Result *result_a = (const Result*)a;
+    const Result *result_b = (const Result*)b;
+
+    if (result_a->generations != result_b->generations) {
+        return result_a->generations < result_b->generations ? 1 : -1;
+    }
+    return result_a->seed < result_b->seed ? -1 : 1;
+}
+
+static double s_time_get_sec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static void s_report(Search *search, int num_threads, uint8_t density, double elapsed) {
+    uint32_t endless = 0;
+    uint64_t total = 0;
+
+    qsort(search->results, search->count, sizeof(Result), s_result_compare);
+    for (uint32_t i = 0; i < search->count; i++) {
+        if (search->results[i].generations < MAX_GENERATIONS) {
+            total += search->results[i].generations;
+        } else {
+            endless++;
+        }
+    }
+    uint32_t settled = search->count - endless;
+    printf("# %u soups of %dx%d at %u%%, seeds %u..%u, %d threads, %.1f s\n",
+           search->count, search->size.row, search->size.column, density,
+           search->first_seed, search->first_seed + search->count - 1, num_threads, elapsed);
+    printf("# %u settled after %.0f generations on average, %u not after %d\n",
+           settled, settled == 0 ? 0.0 : (double)total / settled, endless, MAX_GENERATIONS);
+    printf("# seed      generations population\n");
+    for (uint32_t i = endless; (i < search->count) && (i < (endless + REPORT_LINES)); i++) {
+        printf("%-11u %11u %10u\n", search->results[i].seed, search->results[i].generations,
+               search->results[i].population);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    pthread_t threads[MAX_THREADS];
+    Search search;
+    uint8_t density = DEFAULT_SOUP_DENSITY;
+
+    memset(&search, 0x00, sizeof(Search));
+    search.size = SEARCH_SIZE;
+    search.count = argc >= 2 ? strtoul(argv[1], NULL, 0) : SEEDS;
+    search.first_seed = argc >= 3 ? strtoul(argv[2], NULL, 0) : 1;
+    if (argc >= 5) {
+        search.size = (CSize){atoi(argv[3]), atoi(argv[4])};
+    }
+    if (argc >= 6) {
+        density = atoi(argv[5]);
+        cells_set_soup_density(density);
+    }
+    if ((search.count == 0) || (search.size.row == 0) || (search.size.column == 0)) {
+        printf("usage: search [COUNT [FIRST [ROWS COLUMNS [DENSITY]]]]\n");
+        return 2;
+    }
+    search.results = calloc(search.count, sizeof(Result));
+    if (search.results == NULL) {
+        printf("FAIL cannot keep %u results\n", search.count);
+        return 1;
+    }
+    pthread_mutex_init(&search.soup, NULL);
+
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = num_threads < 1 ? 1 : (MAX_THREADS < num_threads ? MAX_THREADS : num_threads);
+    double started = s_time_get_sec();
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, s_worker_main, &search);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = s_time_get_sec() - started;
+
+    // soups are left unrun only when no worker could create its cells
+    for (uint32_t i = 0; i < search.count; i++) {
+        if (search.results[i].generations == 0) {
+            printf("FAIL cells_create(%dx%d)\n", search.size.row, search.size.column);
+            return 1;
+        }
+    }
+    s_report(&search, num_threads, density, elapsed);
+    pthread_mutex_destroy(&search.soup);
+    free(search.results);
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <pebble.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "cells.h"
+
+// Evolves large grids in stripes on 1 to MAX_THREADS threads, a stripe
+// and a CStats each, checks that every thread count ends on the same
+// cells as one thread does, and reports the speed of each count.
+//   stripes                 1024x1024 and 4096x4096
+//   stripes ROWS COLUMNS    that grid only
+
+#define MAX_THREADS     (16)
+#define BENCH_CELLS     (400e6)     // cells evolved in each run, the same time for each grid
+
+typedef struct bench Bench;
+
+typedef struct worker {
+    pthread_t thread;
+    Bench *bench;
+    uint16_t row_begin;
+    uint16_t row_end;
+} Worker;
+
+struct bench {
+    Cells *cells;
+    int generations;
+    int num_threads;
+    pthread_barrier_t evolved;      // every stripe is done
+    pthread_barrier_t committed;    // the next generation may start
+    Worker workers[MAX_THREADS];
+    CStats stats[MAX_THREADS];
+};
+
+static void s_evolution_stripe(Bench *bench, int index) {
+    Worker *worker = &bench->workers[index];
+
+    memset(&bench->stats[index], 0x00, sizeof(CStats));
+    cells_evolution_stripe(bench->cells, worker->row_begin, worker->row_end, &bench->stats[index]);
+}
+
+static void *s_worker_main(void *context) {
+    Worker *worker = (Worker*)context;
+    Bench *bench = worker->bench;
+    int index = worker - bench->workers;
+
+    for (int gen = 0; gen < bench->generations; gen++) {
+        s_evolution_stripe(bench, index);
+        pthread_barrier_wait(&bench->evolved);
+        pthread_barrier_wait(&bench->committed);
+    }
+    return NULL;
+}
+
+static double s_time_get_sec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+// FNV-1a of every row, to compare the runs.
+static uint32_t s_hash_cells(const Cells *cells) {
+    CSize size = cells_get_size(cells);
+    uint32_t *bits = malloc(sizeof(uint32_t) * CELLS_ROW_WORDS(size.column));
+    uint32_t hash = 2166136261u;
+
+    for (int row = 0; row < size.row; row++) {
+        cells_get_row(cells, row, bits);
+        for (int word = 0; word < CELLS_ROW_WORDS(size.column); word++) {
+            hash = (hash ^ bits[word]) * 16777619u;
+        }
+    }
+    free(bits);
+    return hash;
+}
+
+// The same soup every time. The thread which called it evolves the first
+// stripe and commits each generation, the others the rest.
+static double s_bench_run(Bench *bench, CEngine engine, int num_threads) {
+    CSize size = cells_get_size(bench->cells);
+
+    (void)cells_set_engine(bench->cells, engine);
+    cells_set_max_period(bench->cells, 1);
+    cells_set_random_seed(1);
+    cells_set_pattern(bench->cells, CP_Soup);
+    bench->num_threads = num_threads;
+    pthread_barrier_init(&bench->evolved, NULL, num_threads);
+    pthread_barrier_init(&bench->committed, NULL, num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        bench->workers[i].bench = bench;
+        bench->workers[i].row_begin = (size.row * i) / num_threads;
+        bench->workers[i].row_end = (size.row * (i + 1)) / num_threads;
+    }
+
+    double started = s_time_get_sec();
+    for (int i = 1; i < num_threads; i++) {
+        pthread_create(&bench->workers[i].thread, NULL, s_worker_main, &bench->workers[i]);
+    }
+    for (int gen = 0; gen < bench->generations; gen++) {
+        s_evolution_stripe(bench, 0);
+        pthread_barrier_wait(&bench->evolved);
+        (void)cells_evolution_commit(bench->cells, bench->stats, num_threads);
+        pthread_barrier_wait(&bench->committed);
+    }
+    for (int i = 1; i < num_threads; i++) {
+        pthread_join(bench->workers[i].thread, NULL);
+    }
+    double elapsed = s_time_get_sec() - started;
+
+    pthread_barrier_destroy(&bench->evolved);
+    pthread_barrier_destroy(&bench->committed);
+    return ((double)size.row * size.column * bench->generations) / elapsed;
+}
+
+static int s_bench(CSize size) {
+    static const char *engine_names[MAX_CENGINE] = {"word", "change list"};
+    Bench bench;
+    int fails = 0;
+
+    bench.cells = cells_create(size);
+    if (bench.cells == NULL) {
+        printf("FAIL cells_create(%dx%d)\n", size.row, size.column);
+        return 1;
+    }
+    bench.generations = BENCH_CELLS / ((double)size.row * size.column);
+    if (bench.generations < 4) {
+        bench.generations = 4;
+    }
+    for (int engine = 0; engine < MAX_CENGINE; engine++) {
+        double single = 0;
+        uint32_t expect = 0;
+        for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+            double speed = s_bench_run(&bench, (CEngine)engine, num_threads);
+            uint32_t hash = s_hash_cells(bench.cells);
+            if (num_threads == 1) {
+                single = speed;
+                expect = hash;
+            }
+            printf("%4dx%-5d %-12s %2d threads %9.1f Mcell/s  x%.2f%s\n",
+                   size.row, size.column, engine_names[engine], num_threads,
+                   speed / 1e6, speed / single, hash == expect ? "" : "  FAIL differs from 1 thread");
+            if (hash != expect) {
+                fails++;
+            }
+        }
+    }
+    cells_destroy(bench.cells);
+    return fails;
+}
+
+int main(int argc, char *argv[]) {
+    int fails = 0;
+
+    printf("%ld cpus online\n", sysconf(_SC_NPROCESSORS_ONLN));
+    if (argc == 3) {
+        fails += s_bench((CSize){atoi(argv[1]), atoi(argv[2])});
+    } else {
+        fails += s_bench((CSize){1024, 1024});
+        fails += s_bench((CSize){4096, 4096});
+    }
+    return fails == 0 ? 0 : 1;
+}
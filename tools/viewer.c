@@ -0,0 +1,336 @@
+#include <pebble.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "cells.h"
+
+// Shows a soup evolving in an ANSI terminal. The engine runs on its own
+// thread and offers each generation to a lock-free single-producer,
+// single-consumer queue of QUEUE_FRAMES frames; a generation offered to a
+// full queue is dropped, so the terminal never holds the engine back. The
+// terminal takes the newest frame 30 times a second at most and shows it
+// with 2x2 cells per character in quarter blocks, a character set when any
+// cell it covers is alive, and writes only the characters which changed.
+// A new soup starts when one settles.
+//   viewer                          1000x1000 until interrupted
+//   viewer ROWS COLUMNS [FRAMES]    that world, for FRAMES frames if not 0
+
+#define VIEW_SIZE           (CSize){1000, 1000}
+#define QUEUE_FRAMES        (4)
+#define FRAME_USEC          (33333)     // 30 frames per second
+#define DEFAULT_COLUMNS     (80)        // when the output is not a terminal
+#define DEFAULT_LINES       (24)
+
+// indexed by the quarters set: 1 top left, 2 top right, 4 bottom left, 8 bottom right
+static const char *s_quarters[16] = {
+    " ", "▘", "▝", "▀", "▖", "▌", "▞", "▛",
+    "▗", "▚", "▐", "▜", "▄", "▙", "▟", "█"
+};
+
+typedef struct frame {
+    uint32_t generation;
+    uint32_t *rows;
+} Frame;
+
+typedef struct queue {
+    Frame frames[QUEUE_FRAMES];
+    uint32_t head;          // frames offered, written by the engine only
+    uint32_t tail;          // frames taken, written by the terminal only
+    uint32_t taken;         // the head when the terminal last took a frame
+} Queue;
+
+typedef struct view {
+    Cells *cells;
+    CSize size;
+    uint16_t words;         // per row
+    Queue queue;
+    bool is_stopped;
+    uint32_t generations;   // evolved, read by the terminal for the speed
+    uint32_t dropped;       // generations offered to a full queue
+} View;
+
+typedef struct screen {
+    int columns;
+    int lines;              // for the world, one more for the status
+    int scale;              // cells per quarter both ways
+    uint8_t *quarters;      // drawn now, per character
+    uint8_t *shown;         // on the terminal
+    uint32_t *fold;         // the rows of a quarter OR-ed together
+    uint32_t population;    // of the frame drawn, which may be more than CStats holds
+    char *out;
+    size_t out_length;
+} Screen;
+
+static volatile sig_atomic_t s_is_interrupted = 0;
+
+static void s_interrupt(int signal) {
+    s_is_interrupted = 1;
+}
+
+// The engine side of the queue.
+static void s_queue_offer(View *view) {
+    Queue *queue = &view->queue;
+    uint32_t head = queue->head;
+
+    if ((head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) == QUEUE_FRAMES) {
+        __atomic_fetch_add(&view->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    Frame *frame = &queue->frames[head % QUEUE_FRAMES];
+    for (int row = 0; row < view->size.row; row++) {
+        cells_get_row(view->cells, row, &frame->rows[row * view->words]);
+    }
+    frame->generation = view->generations;
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// The terminal side: the newest frame, NULL if none is new. It and the
+// frames before it stay the terminal's until s_queue_release().
+static const Frame *s_queue_take(Queue *queue) {
+    queue->taken = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (queue->taken == queue->tail) {
+        return NULL;
+    }
+    return &queue->frames[(queue->taken - 1) % QUEUE_FRAMES];
+}
+
+static void s_queue_release(Queue *queue) {
+    __atomic_store_n(&queue->tail, queue->taken, __ATOMIC_RELEASE);
+}
+
+static void *s_engine_main(void *context) {
+    View *view = (View*)context;
+
+    while (__atomic_load_n(&view->is_stopped, __ATOMIC_RELAXED) == false) {
+        if (cells_evolution(view->cells) == false) {
+            cells_set_pattern(view->cells, CP_Soup);
+        }
+        __atomic_store_n(&view->generations, view->generations + 1, __ATOMIC_RELAXED);
+        s_queue_offer(view);
+    }
+    return NULL;
+}
+
+static double s_time_get_sec(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+static void s_out(Screen *screen, const char *text) {
+    size_t length = strlen(text);
+
+    memcpy(&screen->out[screen->out_length], text, length);
+    screen->out_length += length;
+}
+
+static void s_out_flush(Screen *screen) {
+    (void)fwrite(screen->out, 1, screen->out_length, stdout);
+    fflush(stdout);
+    screen->out_length = 0;
+}
+
+static void s_screen_destroy(Screen *screen) {
+    free(screen->quarters);
+    free(screen->shown);
+    free(screen->fold);
+    free(screen->out);
+    memset(screen, 0x00, sizeof(Screen));
+}
+
+// Fits the whole world in the terminal as it is now. Returns false when
+// out of memory.
+static bool s_screen_fit(Screen *screen, const View *view) {
+    struct winsize winsize;
+    int columns = DEFAULT_COLUMNS;
+    int lines = DEFAULT_LINES - 1;
+
+    if ((isatty(STDOUT_FILENO) == 1) && (ioctl(STDOUT_FILENO, TIOCGWINSZ, &winsize) == 0) &&
+        (winsize.ws_col > 0) && (winsize.ws_row > 1)) {
+        columns = winsize.ws_col;
+        lines = winsize.ws_row - 1;
+    }
+    if ((screen->quarters != NULL) && (columns == screen->columns) && (lines == screen->lines)) {
+        return true;
+    }
+    s_screen_destroy(screen);
+    screen->columns = columns;
+    screen->lines = lines;
+    screen->scale = 1;
+    while (((columns * 2 * screen->scale) < view->size.column) || ((lines * 2 * screen->scale) < view->size.row)) {
+        screen->scale++;
+    }
+    screen->quarters = malloc(columns * lines);
+    screen->shown = malloc(columns * lines);
+    screen->fold = malloc(sizeof(uint32_t) * view->words);
+    // a cursor move and a quarter for each character, and the status
+    screen->out = malloc((columns * lines * 16) + columns + 64);
+    if ((screen->quarters == NULL) || (screen->shown == NULL) || (screen->fold == NULL) || (screen->out == NULL)) {
+        s_screen_destroy(screen);
+        return false;
+    }
+    // cleared, every character a space
+    memset(screen->shown, 0x00, columns * lines);
+    s_out(screen, "\x1b[2J");
+    return true;
+}
+
+// True if any of columns 'begin' up to 'end' is set.
+static bool s_is_any(const uint32_t *bits, int begin, int end) {
+    while (begin < end) {
+        int word = begin / 32;
+        int bit = begin % 32;
+        int count = (end - begin) < (32 - bit) ? (end - begin) : (32 - bit);
+        uint32_t mask = (count == 32) ? ~0u : (((1u << count) - 1) << bit);
+        if ((bits[word] & mask) != 0) {
+            return true;
+        }
+        begin += count;
+    }
+    return false;
+}
+
+static void s_screen_draw(Screen *screen, const View *view, const Frame *frame) {
+    int scale = screen->scale;
+
+    memset(screen->quarters, 0x00, screen->columns * screen->lines);
+    screen->population = 0;
+    for (int y = 0; (y < (screen->lines * 2)) && ((y * scale) < view->size.row); y++) {
+        int row_end = (y + 1) * scale < view->size.row ? (y + 1) * scale : view->size.row;
+        memset(screen->fold, 0x00, sizeof(uint32_t) * view->words);
+        for (int row = y * scale; row < row_end; row++) {
+            for (int word = 0; word < view->words; word++) {
+                screen->fold[word] |= frame->rows[(row * view->words) + word];
+                screen->population += __builtin_popcount(frame->rows[(row * view->words) + word]);
+            }
+        }
+        for (int x = 0; (x < (screen->columns * 2)) && ((x * scale) < view->size.column); x++) {
+            int column_end = (x + 1) * scale < view->size.column ? (x + 1) * scale : view->size.column;
+            if (s_is_any(screen->fold, x * scale, column_end) == true) {
+                screen->quarters[((y / 2) * screen->columns) + (x / 2)] |= 1 << (((y % 2) * 2) + (x % 2));
+            }
+        }
+    }
+}
+
+// Writes the characters which differ from the terminal, moving the cursor
+// only over the ones which do not.
+static void s_screen_update(Screen *screen) {
+    char move[32];
+
+    for (int line = 0; line < screen->lines; line++) {
+        bool is_cursor_here = false;
+        for (int column = 0; column < screen->columns; column++) {
+            int index = (line * screen->columns) + column;
+            if (screen->quarters[index] == screen->shown[index]) {
+                is_cursor_here = false;
+                continue;
+            }
+            if (is_cursor_here == false) {
+                snprintf(move, sizeof(move), "\x1b[%d;%dH", line + 1, column + 1);
+                s_out(screen, move);
+                is_cursor_here = true;
+            }
+            s_out(screen, s_quarters[screen->quarters[index]]);
+            screen->shown[index] = screen->quarters[index];
+        }
+    }
+}
+
+static void s_screen_status(Screen *screen, const View *view, const Frame *frame, double engine_speed, double frame_speed) {
+    char status[256];
+    char move[32];
+
+    snprintf(status, sizeof(status), "%dx%d 1:%d  gen %u  pop %u  %.0f gen/s  %.0f fps  %u dropped",
+             view->size.row, view->size.column, screen->scale, frame->generation, screen->population,
+             engine_speed, frame_speed, __atomic_load_n(&view->dropped, __ATOMIC_RELAXED));
+    status[screen->columns < (int)sizeof(status) ? screen->columns : (int)sizeof(status) - 1] = '\0';
+    snprintf(move, sizeof(move), "\x1b[%d;1H\x1b[K", screen->lines + 1);
+    s_out(screen, move);
+    s_out(screen, status);
+}
+
+static bool s_view_create(View *view, CSize size) {
+    memset(view, 0x00, sizeof(View));
+    view->size = size;
+    view->words = CELLS_ROW_WORDS(size.column);
+    view->cells = cells_create(size);
+    if (view->cells == NULL) {
+        return false;
+    }
+    for (int i = 0; i < QUEUE_FRAMES; i++) {
+        view->queue.frames[i].rows = malloc(sizeof(uint32_t) * view->words * size.row);
+        if (view->queue.frames[i].rows == NULL) {
+            return false;
+        }
+    }
+    (void)cells_set_engine(view->cells, CE_ChangeList);
+    cells_set_random_seed(time(NULL));
+    cells_set_pattern(view->cells, CP_Soup);
+    return true;
+}
+
+static void s_view_destroy(View *view) {
+    for (int i = 0; i < QUEUE_FRAMES; i++) {
+        free(view->queue.frames[i].rows);
+    }
+    cells_destroy(view->cells);
+}
+
+int main(int argc, char *argv[]) {
+    CSize size = VIEW_SIZE;
+    uint32_t max_frames = 0;
+    pthread_t engine;
+    Screen screen;
+    View view;
+
+    if (argc >= 3) {
+        size = (CSize){atoi(argv[1]), atoi(argv[2])};
+        max_frames = argc >= 4 ? strtoul(argv[3], NULL, 0) : 0;
+    }
+    if ((argc == 2) || (size.row == 0) || (size.column == 0)) {
+        printf("usage: viewer [ROWS COLUMNS [FRAMES]]\n");
+        return 2;
+    }
+    if (s_view_create(&view, size) == false) {
+        printf("FAIL cannot create %dx%d\n", size.row, size.column);
+        s_view_destroy(&view);
+        return 1;
+    }
+    memset(&screen, 0x00, sizeof(Screen));
+    signal(SIGINT, s_interrupt);
+    signal(SIGTERM, s_interrupt);
+    pthread_create(&engine, NULL, s_engine_main, &view);
+    printf("\x1b[?25l");
+
+    double started = s_time_get_sec();
+    uint32_t frames = 0;
+    while ((s_is_interrupted == 0) && ((max_frames == 0) || (frames < max_frames))) {
+        usleep(FRAME_USEC);
+        const Frame *frame = s_queue_take(&view.queue);
+        if (frame == NULL) {
+            continue;
+        }
+        if (s_screen_fit(&screen, &view) == false) {
+            s_queue_release(&view.queue);
+            break;
+        }
+        frames++;
+        double elapsed = s_time_get_sec() - started;
+        s_screen_draw(&screen, &view, frame);
+        s_screen_update(&screen);
+        s_screen_status(&screen, &view, frame, __atomic_load_n(&view.generations, __ATOMIC_RELAXED) / elapsed,
+                        frames / elapsed);
+        s_queue_release(&view.queue);
+        s_out_flush(&screen);
+    }
+
+    __atomic_store_n(&view.is_stopped, true, __ATOMIC_RELAXED);
+    pthread_join(engine, NULL);
+    printf("\x1b[0m\x1b[?25h\n");
+    s_screen_destroy(&screen);
+    s_view_destroy(&view);
+    return 0;
+}